@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <chrono>
-#include "secs/container.h"
+#include <random>
+#include "secs.h"
 
 // TODO: these benchmarks are too simplisitc be meanigful, improve them!
 
@@ -25,6 +27,15 @@ struct Velocity {
   {}
 };
 
+struct Position {
+  float x = 0;
+  float y = 0;
+};
+
+struct Health {
+  float value = 1;
+};
+
 static const size_t COUNT = 100000;
 
 template<typename F>
@@ -189,6 +200,473 @@ void compare_component_ptr_and_raw_ptr() {
   use(result);
 }
 
+void iterate_container_with_rare_components() {
+  Container container;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    if (i % 100 == 0) e.create_component<Velocity>(random_number(), random_number());
+  }
+
+  float result = 0;
+
+  benchmark("iterate container with 1% owners", [&]() {
+    container.entities<Velocity>().each([&](auto& v) {
+      result += compute(v);
+    });
+  });
+
+  use(result);
+}
+
+// Every third Entity has all three components, the rest have only some.
+void iterate_container_with_three_components(Engine engine, const string& label) {
+  Container container(engine);
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Velocity>(random_number(), random_number());
+
+    if (i % 3 != 1) e.create_component<Position>();
+    if (i % 3 != 2) e.create_component<Health>();
+  }
+
+  float result = 0;
+
+  benchmark(label, [&]() {
+    container.entities<Position, Velocity, Health>().each(
+      [&](auto& p, auto& v, auto& h) {
+        result += p.x + compute(v) * h.value;
+      });
+  });
+
+  use(result);
+}
+
+struct Mass   { float value = 1; };
+struct Flying {};
+
+// Query five components, of which all are owned by a quarter of the Entities.
+void iterate_container_with_five_components() {
+  Container container;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Velocity>(random_number(), random_number());
+    e.create_component<Position>();
+
+    if (i % 2 == 0) e.create_component<Health>();
+    if (i % 4 <  2) e.create_component<Mass>();
+    if (i % 8 != 7) e.create_component<Flying>();
+  }
+
+  float result = 0;
+
+  benchmark("iterate 5 components using iterator", [&]() {
+    for (auto e : container.entities<Position, Velocity, Health, Mass, Flying>()) {
+      result += compute(*e.component<Velocity>());
+    }
+  });
+
+  benchmark("iterate 5 components using each", [&]() {
+    container.entities<Position, Velocity, Health, Mass, Flying>().each(
+      [&](auto&, auto& v, auto&, auto&, auto&) {
+        result += compute(v);
+      });
+  });
+
+  use(result);
+}
+
+struct Sprite    { float depth = 0; };
+struct Transform { float x = 0, y = 0, matrix[14] = {}; };
+
+namespace secs {
+template<> struct StoragePolicy<Sprite>    { using type = SparseSetStorage; };
+template<> struct StoragePolicy<Transform> { using type = SparseSetStorage; };
+}
+
+// The components are added in shuffled order, so visiting the Sprites gathers
+// the Transforms randomly, until both stores are sorted together.
+void iterate_sorted_components() {
+  Container container;
+  vector<Entity> entities;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Sprite>(Sprite{ random_number() });
+    entities.push_back(e);
+  }
+
+  std::shuffle(entities.begin(), entities.end(), gen);
+
+  for (auto e : entities) {
+    e.create_component<Transform>();
+  }
+
+  float result = 0;
+  auto  draw   = [&](auto& s, auto& t) { result += s.depth + t.x; };
+
+  benchmark("iterate 2 unsorted sparse components", [&]() {
+    container.entities<Sprite, Transform>().each(draw);
+  });
+
+  benchmark("sort 2 sparse components", [&]() {
+    container.sort_by<Sprite, Transform>([](auto& s) { return s.depth; });
+  });
+
+  benchmark("iterate 2 sorted sparse components", [&]() {
+    container.entities<Sprite, Transform>().each(draw);
+  });
+
+  use(result);
+}
+
+struct Body   { float x = 0, y = 0; };
+struct Motion { float x = 0, y = 0; };
+
+namespace secs {
+template<> struct StoragePolicy<Body>   { using type = SparseSetStorage; };
+template<> struct StoragePolicy<Motion> { using type = SparseSetStorage; };
+}
+
+// Half of the Entities with Body have Motion too.
+void iterate_group(bool grouped, const string& label) {
+  Container container;
+
+  if (grouped) container.group<Body, Motion>();
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    if (i % 4 != 3) e.create_component<Body>();
+    if (i % 4 <  2) e.create_component<Motion>(Motion{ random_number(), 0 });
+  }
+
+  benchmark(label, [&]() {
+    container.entities<Body, Motion>().each([](auto& b, auto& m) {
+      b.x += m.x;
+      b.y += m.y;
+    });
+  });
+
+  float result = 0;
+
+  container.entities<Body>().each([&](auto& b) { result += b.x; });
+  use(result);
+}
+
+// Every Entity has Body, 50 of them have Motion. Listing Body first used to
+// drive the query with its store.
+void iterate_rare_sparse_components() {
+  Container container;
+
+  for (size_t i = 0; i < 10 * COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Body>();
+    if (i % (COUNT / 5) == 0) e.create_component<Motion>();
+  }
+
+  float result = 0;
+
+  benchmark("iterate Body with 50 rare Motions", [&]() {
+    container.entities<Body, Motion>().each([&](auto& b, auto& m) {
+      result += b.x + m.x;
+    });
+  });
+
+  use(result);
+}
+
+struct Frozen { bool value = true; };
+
+// A quarter of the moving Entities are frozen.
+void iterate_without_components() {
+  Container container;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Position>();
+    e.create_component<Velocity>(random_number(), random_number());
+    if (i % 4 == 0) e.create_component<Frozen>();
+  }
+
+  benchmark("iterate movers checking !component<Frozen>()", [&]() {
+    container.entities<Position, Velocity>().each(
+      [](const Entity& e, Position& p, Velocity& v) {
+        if (e.component<Frozen>()) return;
+        p.x += v.x;
+        p.y += v.y;
+      });
+  });
+
+  benchmark("iterate movers Without<Frozen>", [&]() {
+    container.entities<Position, Velocity, Without<Frozen>>().each(
+      [](Position& p, Velocity& v) {
+        p.x += v.x;
+        p.y += v.y;
+      });
+  });
+}
+
+// One Entity in 100 has Velocity, scattered among the Positions.
+void iterate_cached_query() {
+  Container container;
+
+  for (size_t i = 0; i < 10 * COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Position>();
+    if (i % 100 == 0) {
+      e.create_component<Velocity>(random_number(), random_number());
+    }
+  }
+
+  auto integrate = [](Position& p, const Velocity& v) {
+    p.x += v.x;
+    p.y += v.y;
+  };
+
+  benchmark("iterate rare Velocities filtering each time", [&]() {
+    container.entities<Position, Velocity>().each(integrate);
+  });
+
+  auto& query = container.query<Position, Velocity>();
+
+  benchmark("iterate rare Velocities with a cached query", [&]() {
+    query.each(integrate);
+  });
+}
+
+template<int N> struct Kind { float value = N; };
+
+template<int... Ns>
+void register_kinds(Container& container, std::integer_sequence<int, Ns...>) {
+  auto e = container.create();
+
+  int expand[] = { 0, (e.create_component<Kind<Ns>>(), 0)... };
+  (void) expand;
+
+  e.destroy();
+}
+
+// Entities own 4 components out of 150 types registered in the Container.
+void destroy_with_many_types() {
+  Container container;
+  register_kinds(container, std::make_integer_sequence<int, 150>());
+
+  vector<Entity> entities;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Velocity>();
+    e.create_component<Position>();
+    e.create_component<Health>();
+    e.create_component<Kind<77>>();
+    entities.push_back(e);
+  }
+
+  benchmark("destroy entities with 150 types registered", [&]() {
+    for (auto e : entities) e.destroy();
+  });
+}
+
+// Access components of Entities in a Container with 150 types registered.
+void access_with_many_types() {
+  Container container;
+  register_kinds(container, std::make_integer_sequence<int, 150>());
+
+  vector<Entity> entities;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Velocity>();
+    e.create_component<Kind<77>>();
+    entities.push_back(e);
+  }
+
+  float result = 0;
+
+  benchmark("component<T>() with 150 types registered", [&]() {
+    for (auto e : entities) {
+      result += e.component<Velocity>()->x + e.component<Kind<77>>()->value;
+    }
+  });
+
+  use(result);
+}
+
+struct Ping {
+  Entity entity;
+};
+
+template<int N>
+void event_handle(Kind<N>& kind, const Ping&) {
+  kind.value += 1;
+}
+
+// Subscribe the kinds to Ping either through connect<E, T>() or through
+// a handler per kind looking the component up, as connect<E, T>() used to.
+template<int... Ns>
+void connect_kinds( Container& container
+                  , bool       routed
+                  , std::integer_sequence<int, Ns...>)
+{
+  if (routed) {
+    int expand[] = { 0, (container.connect<Ping, Kind<Ns>>(), 0)... };
+    (void) expand;
+  } else {
+    int expand[] = { 0, (container.connect<Ping>([](const Ping& ping) {
+      if (auto kind = ping.entity.component<Kind<Ns>>()) {
+        event_handle(*kind, ping);
+      }
+    }), 0)... };
+    (void) expand;
+  }
+}
+
+template<int... Ns>
+void create_kind(Entity entity, int n, std::integer_sequence<int, Ns...>) {
+  int expand[] = {
+    0, (n == Ns ? (entity.create_component<Kind<Ns>>(), 0) : 0)...
+  };
+  (void) expand;
+}
+
+// Entities own one of 32 component types handling the event.
+void route_events(bool routed, const string& label) {
+  using Kinds = std::make_integer_sequence<int, 32>;
+
+  Container container;
+  connect_kinds(container, routed, Kinds());
+
+  vector<Entity> entities;
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    auto e = container.create();
+    create_kind(e, static_cast<int>(i % 32), Kinds());
+    entities.push_back(e);
+  }
+
+  benchmark(label, [&]() {
+    for (auto e : entities) container.emit(Ping{ e });
+  });
+}
+
+// Integrate positions one Entity at a time, and over chunks of adjacent
+// components.
+void integrate_in_chunks() {
+  Container container;
+
+  for (size_t i = 0; i < 10 * COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Position>();
+    if (i % 16) e.create_component<Velocity>(random_number(), random_number());
+  }
+
+  benchmark("integrate 1M entities using each", [&]() {
+    container.entities<Position, Velocity>().each(
+      [](Position& p, Velocity& v) {
+        p.x += v.x * 0.016f;
+        p.y += v.y * 0.016f;
+      });
+  });
+
+  benchmark("integrate 1M entities using each_chunk", [&]() {
+    container.entities<Position, Velocity>().each_chunk(
+      [](Span<const uint32_t> indices, Span<Position> p, Span<Velocity> v) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+          p[i].x += v[i].x * 0.016f;
+          p[i].y += v[i].y * 0.016f;
+        }
+      });
+  });
+}
+
+// Integrate positions of 1M Entities on 1 to N threads.
+void integrate_in_parallel() {
+  Container container;
+
+  for (size_t i = 0; i < 10 * COUNT; ++i) {
+    auto e = container.create();
+    e.create_component<Position>();
+    e.create_component<Velocity>(random_number(), random_number());
+  }
+
+  auto hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+  for (size_t threads = 1; threads <= hardware; threads *= 2) {
+    ThreadPool pool(threads);
+
+    benchmark("par_each over 1M entities on " + std::to_string(threads)
+              + " threads", [&]() {
+      for (int step = 0; step < 10; ++step) {
+        container.entities<Position, Velocity>().par_each(pool,
+          [](Position& p, Velocity& v) {
+            p.x += v.x * 0.016f;
+            p.y += v.y * 0.016f;
+          });
+      }
+    });
+  }
+}
+
+// Build and tear down a world of COUNT Entities with all its storage coming
+// from the given resource.
+void build_world(MemoryResource& resource, const string& label) {
+  benchmark(label, [&]() {
+    Container container(resource);
+
+    for (size_t i = 0; i < COUNT; ++i) {
+      auto e = container.create();
+      e.create_component<Velocity>(random_number(), random_number());
+
+      if (i % 2 == 0) e.create_component<Position>();
+      if (i % 3 == 0) e.create_component<Health>();
+    }
+  });
+}
+
+void build_world_with_memory_resources() {
+  build_world(*new_delete_resource(), "build world (new_delete_resource)");
+
+  {
+    MonotonicResource resource;
+    build_world(resource, "build world (MonotonicResource)");
+  }
+
+  {
+    PoolResource resource;
+    build_world(resource, "build world (PoolResource)");
+  }
+}
+
+struct Hit {
+  int damage = 0;
+};
+
+void emit_events() {
+  Container container;
+  int       total = 0;
+
+  container.connect<Hit>([&](const Hit& hit) { total += hit.damage; });
+  container.connect<Hit>([&](const Hit& hit) { total -= hit.damage / 2; });
+
+  benchmark("emit 10M events to 2 handlers", [&]() {
+    for (size_t i = 0; i < 100 * COUNT; ++i) {
+      container.emit(Hit{ 1 });
+    }
+  });
+
+  vector<Hit> hits(1000, Hit{ 1 });
+
+  benchmark("emit 10M events to 2 handlers in batches", [&]() {
+    for (size_t i = 0; i < 100 * COUNT / hits.size(); ++i) {
+      container.emit_batch<Hit>(hits);
+    }
+  });
+
+  use(static_cast<float>(total));
+}
+
 int main() {
   iterate_vector_of_values();
   iterate_vector_of_pointers();
@@ -196,7 +674,38 @@ int main() {
   iterate_container_with_required_components();
   iterate_container_with_optional_components();
 
+  iterate_container_with_rare_components();
+
   compare_component_ptr_and_raw_ptr();
 
+  iterate_container_with_five_components();
+
+  iterate_container_with_three_components(
+      Engine::stores,     "iterate 3 components (stores engine)");
+  iterate_container_with_three_components(
+      Engine::archetypes, "iterate 3 components (archetypes engine)");
+
+  iterate_sorted_components();
+
+  iterate_group(false, "iterate 2 sparse components without group");
+  iterate_group(true,  "iterate 2 sparse components with group");
+
+  iterate_rare_sparse_components();
+  iterate_without_components();
+  iterate_cached_query();
+
+  destroy_with_many_types();
+  access_with_many_types();
+
+  build_world_with_memory_resources();
+
+  integrate_in_chunks();
+  integrate_in_parallel();
+
+  emit_events();
+
+  route_events(false, "emit to 32 types with a lookup per type");
+  route_events(true,  "emit to 32 types routed by signature");
+
   return 0;
 }
\ No newline at end of file
@@ -1,88 +1,212 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+#include "secs/inline_storage.h"
+#include "secs/memory_resource.h"
 
 // Partially unsafe, type-erased storage for any type.
 //
 // Any can hold value of any type. It is safe to copy, move and destroy.
 // Retrieval of the value is not safe, as there is no check that the retrieved
 // type is the same as the stored type. This is reponsibility of the user.
+//
+// Values which fit into the inline buffer of Size bytes (and are nothrow move
+// constructible) are stored inside the Any itself and relocated when the Any
+// is moved. Bigger values are allocated from a MemoryResource, which is the
+// new-delete resource unless given to emplace_in().
 
 namespace secs {
 
-class Any {
+template<size_t Size>
+class BasicAny {
 private:
+  static_assert( Size >= 2 * sizeof(void*)
+               , "The buffer must fit a pointer and its resource");
+
+  using Buffer = detail::InlineBuffer<Size>;
+  using Heap   = detail::HeapValue;
+
   template<typename T, typename R = void>
   using disable_if_self = std::enable_if_t<
-    !std::is_same<typename std::decay<T>::type, Any>::value, R>;
+    !std::is_same<typename std::decay<T>::type, BasicAny>::value, R>;
+
+  struct Ops {
+    void (*destroy)(BasicAny&);
+    void (*move)(BasicAny& from, BasicAny& to);
+  };
 
   template<typename T>
-  static void destroy(void* store) {
-    delete reinterpret_cast<T*>(store);
-  }
+  struct Inline {
+    static void destroy(BasicAny& any) {
+      any.template get<T>().~T();
+    }
+
+    static void move(BasicAny& from, BasicAny& to) {
+      T& value = from.template get<T>();
+      new (&to._buffer) T(std::move(value));
+      value.~T();
+    }
+
+    static constexpr Ops ops = { &destroy, &move };
+  };
+
+  template<typename T>
+  struct Allocated {
+    static void destroy(BasicAny& any) {
+      Heap::destroy<T>(&any._buffer);
+    }
+
+    static void move(BasicAny& from, BasicAny& to) {
+      new (&to._buffer) Heap(from.heap());
+    }
+
+    static constexpr Ops ops = { &destroy, &move };
+  };
 
 public:
-  Any() {}
+  // Whether values of type T are stored in the inline buffer.
+  template<typename T>
+  static constexpr bool is_inline() {
+    return detail::stores_inline<T, Size>();
+  }
+
+  BasicAny() {}
 
   template<typename T>
-  Any( T&& value, disable_if_self<T, void*> = nullptr)
-    : _store(new T(std::forward<T>(value)))
-    , _destroy(&destroy<T>)
-  {}
+  BasicAny( T&& value, disable_if_self<T, void*> = nullptr)
+  {
+    emplace<T>(std::forward<T>(value));
+  }
 
-  ~Any() {
+  ~BasicAny() {
     reset();
   }
 
-  Any(const Any&) = delete;
-  Any(Any&&) noexcept;
+  BasicAny(const BasicAny&) = delete;
+
+  BasicAny(BasicAny&& other) noexcept {
+    take(other);
+  }
+
+  BasicAny& operator = (const BasicAny&) = delete;
+
+  BasicAny& operator = (BasicAny&& other) {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
 
-  Any& operator = (const Any&) = delete;
-  Any& operator = (Any&&);
+    return *this;
+  }
 
   template<typename T>
-  disable_if_self<T, Any&> operator = (T&& value) {
+  disable_if_self<T, BasicAny&> operator = (T&& value) {
     emplace<T>(std::forward<T>(value));
     return *this;
   }
 
   template<typename T, typename... Args>
   void emplace(Args&&... args) {
+    emplace_in<T>(*new_delete_resource(), std::forward<Args>(args)...);
+  }
+
+  // Construct the value in memory allocated from the resource. Values stored
+  // inline do not use the resource.
+  template<typename T, typename... Args>
+  void emplace_in(MemoryResource& resource, Args&&... args) {
+    using U = typename std::decay<T>::type;
+
     reset();
-    _store = new T(std::forward<Args>(args)...);
-    _destroy = &destroy<T>;
+    construct<U>( resource
+                , std::integral_constant<bool, is_inline<U>()>()
+                , std::forward<Args>(args)...);
   }
 
   template<typename T>
   const T& get() const {
-    assert(*this);
-    return *reinterpret_cast<const T*>(_store);
+    return const_cast<BasicAny*>(this)->get<T>();
   }
 
   template<typename T>
   T& get() {
     assert(*this);
-    return *reinterpret_cast<T*>(_store);
+
+    if (is_inline<T>()) {
+      return *reinterpret_cast<T*>(&_buffer);
+    } else {
+      return Heap::get<T>(&_buffer);
+    }
   }
 
   explicit operator bool () const {
-    return _store != nullptr;
+    return _ops != nullptr;
   }
 
   // Test that this Any contains a value of type T.
   template<typename T>
   bool contains() const {
-    return _destroy == &destroy<T>;
+    return _ops == ops<typename std::decay<T>::type>();
   }
 
-  void reset();
+  void reset() {
+    if (!*this) return;
+
+    _ops->destroy(*this);
+    _ops = nullptr;
+  }
 
 private:
-  using Destroy = void (*)(void*);
+  template<typename T>
+  static const Ops* ops() {
+    using Storage = std::conditional_t< is_inline<T>()
+                                      , Inline<T>
+                                      , Allocated<T>>;
+    return &Storage::ops;
+  }
+
+  template<typename T, typename... Args>
+  void construct(MemoryResource&, std::true_type, Args&&... args) {
+    new (&_buffer) T(std::forward<Args>(args)...);
+    _ops = &Inline<T>::ops;
+  }
 
-  void*   _store   = nullptr;
-  Destroy _destroy = nullptr;
+  template<typename T, typename... Args>
+  void construct(MemoryResource& resource, std::false_type, Args&&... args) {
+    Heap::construct<T>(&_buffer, resource, std::forward<Args>(args)...);
+    _ops = &Allocated<T>::ops;
+  }
+
+  Heap& heap() {
+    return *reinterpret_cast<Heap*>(&_buffer);
+  }
+
+  void take(BasicAny& other) {
+    if (!other) return;
+
+    other._ops->move(other, *this);
+    _ops       = other._ops;
+    other._ops = nullptr;
+  }
+
+private:
+  Buffer     _buffer;
+  const Ops* _ops = nullptr;
 };
 
-} // namespace secs
\ No newline at end of file
+template<size_t Size>
+template<typename T>
+constexpr typename BasicAny<Size>::Ops BasicAny<Size>::Inline<T>::ops;
+
+template<size_t Size>
+template<typename T>
+constexpr typename BasicAny<Size>::Ops BasicAny<Size>::Allocated<T>::ops;
+
+// Any with room for three pointers inline.
+using Any = BasicAny<3 * sizeof(void*)>;
+
+} // namespace secs
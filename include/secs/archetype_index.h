@@ -0,0 +1,126 @@
+#pragma once
+
+// Index of Entities grouped into archetypes: tables of Entities which own
+// exactly the same set of component types.
+//
+// Component types are identified by the Container's type indices. A query for
+// a set of required types (and of excluded ones) resolves to the list of
+// tables whose signature includes the former (and none of the latter), so
+// iterating the query is a linear scan over matching tables.
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "secs/bitset.h"
+#include "secs/memory_resource.h"
+
+namespace secs {
+
+class ArchetypeIndex {
+public:
+  using Table  = Vector<uint32_t>;
+  using Tables = Vector<const Table*>;
+
+  explicit ArchetypeIndex(MemoryResource& resource);
+
+  bool contains(size_t entity) const {
+    return entity < _locations.size() && _locations[entity].archetype != NONE;
+  }
+
+  // Insert the Entity into the archetype with no components.
+  void insert(size_t entity);
+  void erase(size_t entity);
+
+  // Move the Entity to the archetype with/without the given component type.
+  void add(size_t entity, size_t type);
+  void remove(size_t entity, size_t type);
+
+  // Move the Entity to the free index to, keeping its archetype.
+  void relocate(size_t entity, size_t to);
+
+  // Forget indices from size up, which must not contain Entities.
+  void truncate(size_t size);
+
+  // Tables of all archetypes which include the required component types and
+  // none of the excluded ones. The returned reference stays valid for the
+  // lifetime of the index, and the list is extended as new archetypes are
+  // created.
+  const Tables& match( const Bitset& required
+                     , const Bitset& excluded = Bitset());
+
+  // Number of moves of Entities into table rows so far. Entities moved later
+  // than a given count are those which changed archetype (or were created, or
+  // moved into the row of a removed Entity) since.
+  size_t moves() const {
+    return _moves;
+  }
+
+  bool moved_since(size_t entity, size_t moves) const {
+    return contains(entity) && _locations[entity].moved > moves;
+  }
+
+  // Number of archetypes (including the empty one).
+  size_t size() const {
+    return _archetypes.size();
+  }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Archetype {
+    Archetype(const Bitset& signature, MemoryResource& resource)
+      : signature(signature, resource)
+      , entities(resource)
+      , with(resource)
+      , without(resource)
+    {}
+
+    Bitset           signature;
+    Table            entities;
+
+    // Cached transitions to other archetypes, indexed by component type.
+    Vector<uint32_t> with;
+    Vector<uint32_t> without;
+  };
+
+  struct Location {
+    uint32_t archetype = NONE;
+    uint32_t row       = 0;
+
+    // Value of _moves when the Entity was moved into its row.
+    size_t   moved     = 0;
+  };
+
+  struct Match {
+    explicit Match(MemoryResource& resource)
+      : tables(resource)
+    {}
+
+    Tables tables;
+    size_t checked = 0;
+  };
+
+  template<typename V>
+  using Map = std::unordered_map<
+    Bitset, V, BitsetHash, std::equal_to<Bitset>,
+    Allocator<std::pair<const Bitset, V>>>;
+
+  uint32_t find_or_create(const Bitset& signature);
+  uint32_t transition(uint32_t from, size_t type, bool with);
+  void     move(size_t entity, uint32_t to);
+  void     detach(size_t entity);
+
+private:
+  MemoryResource*               _resource;
+  Vector<Location>              _locations;
+  Vector<UniquePtr<Archetype>>  _archetypes;
+  Map<uint32_t>                 _lookup;
+
+  // Matches by required types, then by excluded types.
+  Map<Map<Match>>               _matches;
+  size_t                        _moves = 0;
+};
+
+} // namespace secs
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "secs/memory_resource.h"
+
+namespace secs {
+
+// Index of the lowest set bit. The word must not be zero.
+inline size_t lowest_bit(uint64_t word) {
+  return static_cast<size_t>(__builtin_ctzll(word));
+}
+
+// Dynamically sized set of bits. Bits past the end are implicitly unset.
+class Bitset {
+public:
+  using Word = uint64_t;
+
+  static constexpr size_t WORD_BITS = 64;
+
+  Bitset() = default;
+
+  explicit Bitset(MemoryResource& resource)
+    : _words(resource)
+  {}
+
+  // Copy of other, allocated from the resource.
+  Bitset(const Bitset& other, MemoryResource& resource)
+    : _words(other._words, resource)
+  {}
+
+  bool test(size_t index) const {
+    return word(index / WORD_BITS) & mask(index);
+  }
+
+  void set(size_t index) {
+    auto w = index / WORD_BITS;
+
+    if (w >= _words.size()) {
+      _words.resize(w + 1);
+    }
+
+    _words[w] |= mask(index);
+  }
+
+  void reset(size_t index) {
+    auto w = index / WORD_BITS;
+    if (w < _words.size()) _words[w] &= ~mask(index);
+  }
+
+  bool none() const;
+
+  // Drop trailing zero words and release unused memory.
+  void shrink_to_fit();
+
+  // Test that every bit set in other is also set in this.
+  bool includes(const Bitset& other) const;
+
+  // Test that some bit is set in both this and other.
+  bool intersects(const Bitset& other) const;
+
+  size_t word_count() const {
+    return _words.size();
+  }
+
+  Word word(size_t index) const {
+    return index < _words.size() ? _words[index] : 0;
+  }
+
+  const Word* data() const {
+    return _words.data();
+  }
+
+  size_t hash() const;
+
+private:
+  static Word mask(size_t index) {
+    return Word(1) << (index % WORD_BITS);
+  }
+
+private:
+  Vector<Word> _words;
+
+  friend bool operator == (const Bitset&, const Bitset&);
+};
+
+inline bool operator != (const Bitset& a, const Bitset& b) { return !(a == b); }
+
+struct BitsetHash {
+  size_t operator () (const Bitset& bitset) const {
+    return bitset.hash();
+  }
+};
+
+} // namespace secs
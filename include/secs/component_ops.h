@@ -5,14 +5,17 @@
 
 namespace secs {
 
+class Container;
 class Entity;
 
 class ComponentOps {
 public:
   template<typename T>
   void setup() {
-    _copy    = &copy<T>;
-    _destroy = &destroy<T>;
+    _copy     = &copy<T>;
+    _destroy  = &destroy<T>;
+    _shrink   = &shrink_to_fit<T>;
+    _relocate = &relocate<T>;
   }
 
   explicit operator bool () const {
@@ -29,6 +32,18 @@ public:
     _destroy(entity);
   }
 
+  // Move the components of source to target, which must be in the same
+  // Container and have no components.
+  void relocate(const Entity& source, const Entity& target) {
+    assert(_relocate);
+    _relocate(source, target);
+  }
+
+  void shrink_to_fit(Container& container) {
+    assert(_shrink);
+    _shrink(container);
+  }
+
 private:
 
   template<typename T> static
@@ -40,17 +55,23 @@ private:
   copy(const Entity&, const Entity&);
 
   template<typename T> static void destroy(const Entity&);
+  template<typename T> static void shrink_to_fit(Container&);
+  template<typename T> static void relocate(const Entity&, const Entity&);
 
   static void noop2(const Entity&, const Entity&) {}
   static void noop1(const Entity&) {}
+  static void noop0(Container&) {}
 
 private:
 
   using Fun2 = void (*)(const Entity&, const Entity&);
   using Fun1 = void (*)(const Entity&);
+  using Fun0 = void (*)(Container&);
 
-  Fun2 _copy    = &noop2;
-  Fun1 _destroy = &noop1;
+  Fun2 _copy     = &noop2;
+  Fun1 _destroy  = &noop1;
+  Fun0 _shrink   = &noop0;
+  Fun2 _relocate = &noop2;
 };
 
 } // namespace secs
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "secs/component_ops.h"
+#include "secs/container.h"
 #include "secs/entity.h"
 
 namespace secs {
@@ -17,6 +18,7 @@ template<typename T>
 std::enable_if_t<!std::is_copy_constructible<T>::value, void>
 ComponentOps::copy(const Entity& source, const Entity&) {
   assert(!source.component<T>());
+  (void) source;
 }
 
 template<typename T>
@@ -24,4 +26,14 @@ void ComponentOps::destroy(const Entity& entity) {
   entity.destroy_component<T>();
 }
 
+template<typename T>
+void ComponentOps::shrink_to_fit(Container& container) {
+  container.store<T>().shrink_to_fit();
+}
+
+template<typename T>
+void ComponentOps::relocate(const Entity& source, const Entity& target) {
+  source.container().relocate_component<T>(source, target);
+}
+
 } // namespace secs
@@ -1,11 +1,13 @@
 #pragma once
 
-#include <cmath>
-#include <cstring>
+#include <cassert>
 #include <memory>
 #include <type_traits>
 #include <vector>
 
+#include "secs/bitset.h"
+#include "secs/memory_resource.h"
+#include "secs/storage_policy.h"
 #include "secs/version.h"
 
 namespace secs {
@@ -13,40 +15,6 @@ namespace detail {
   template<typename T>
   using Store = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
 
-  template<typename T>
-  T* ptr(Store<T>* data, size_t index) {
-    return reinterpret_cast<T*>(data + index);
-  }
-
-  template<typename T>
-  const T* ptr(const Store<T>* data, size_t index) {
-    return reinterpret_cast<T*>(data + index);
-  }
-
-  template<typename T>
-  std::enable_if_t<!std::is_trivially_copyable<T>::value, void>
-  move( Store<T>*                   dst
-      , Store<T>*                   src
-      , size_t                      count
-      , const std::vector<Version>& versions)
-  {
-    for (size_t i = 0; i < count; ++i) {
-      if (versions[i].exists()) {
-        new (ptr<T>(dst, i)) T(std::move(*ptr<T>(src, i)));
-      }
-    }
-  }
-
-  // If T is trivially copyable, we can move the memory much faster using
-  // memcpy.
-  template<typename T>
-  std::enable_if_t<std::is_trivially_copyable<T>::value, void>
-  move(Store<T>* dst, Store<T>* src, size_t count, const std::vector<Version>&) {
-    std::memcpy( reinterpret_cast<void*>(dst)
-               , reinterpret_cast<void*>(src)
-               , count * sizeof(Store<T>));
-  }
-
   template<typename T, typename... Args>
   std::enable_if_t<std::is_move_assignable<T>::value>
   replace(T& dst, Args&&... args) {
@@ -69,18 +37,56 @@ namespace detail {
     new (&dst) T(std::forward<Args>(args)...);
   }
 
+  // Components are relocated only by Container::compact(), which requires them
+  // to be move constructible.
+  template<typename T>
+  std::enable_if_t<std::is_move_constructible<T>::value>
+  move_construct(void* dst, T& src) {
+    new (dst) T(std::move(src));
+  }
+
+  template<typename T>
+  std::enable_if_t<!std::is_move_constructible<T>::value>
+  move_construct(void*, T&) {
+    assert(false && "relocating component which is not move constructible");
+  }
+
 } // namespace detail
 
+// Storage for all Components of type T in a Container, indexed by the index of
+// the owning Entity.
+//
+// The components are stored in fixed-size pages which are allocated on demand
+// and never relocated, so growing the store is O(page) and references to
+// existing components stay valid until the component is erased.
+//
+// All memory, including the pages, is allocated from the given MemoryResource.
 template<typename T>
-class ComponentStore {
+class ComponentStore<T, PagedStorage> {
 public:
-  ComponentStore() = default;
+  static constexpr size_t PAGE_SHIFT = 10;
+  static constexpr size_t PAGE_SIZE  = size_t(1) << PAGE_SHIFT;
+
+  ComponentStore()
+    : ComponentStore(*new_delete_resource())
+  {}
+
+  explicit ComponentStore(MemoryResource& resource)
+    : _resource(&resource)
+    , _pages(resource)
+    , _occupancy(resource)
+  {}
+
   ComponentStore(const ComponentStore&) = delete;
   ComponentStore(ComponentStore&& other) = default;
 
   ~ComponentStore() {
-    for (size_t i = 0; i < size(); ++i) {
-      if (_versions[i].exists()) ptr(i)->~T();
+    for (auto& page : _pages) {
+      if (!page) continue;
+
+      for (size_t i = 0; i < PAGE_SIZE; ++i) {
+        if (page->versions[i].exists()) page->ptr(i)->~T();
+      }
     }
   }
 
@@ -88,15 +94,21 @@ public:
   ComponentStore& operator = (ComponentStore&&) = default;
 
   size_t size() const {
-    return _versions.size();
+    return _pages.size() << PAGE_SHIFT;
   }
 
   bool contains(size_t index, Version version) const {
-    return index < _versions.size() && _versions[index] == version;
+    auto page = find_page(index);
+    return page && page->versions[offset(index)] == version;
   }
 
   bool contains(size_t index) const {
-    return index < _versions.size() && _versions[index].exists();
+    return _occupancy.test(index);
+  }
+
+  // Bit per Entity index, set if the store contains a component for it.
+  const Bitset& occupancy() const {
+    return _occupancy;
   }
 
   T& get(size_t index) {
@@ -112,114 +124,136 @@ public:
   template<typename... Args>
   void emplace(size_t index, Version version, Args&&... args);
 
-  void emplace(size_t index, Version version, const T& other);
-  void emplace(size_t index, Version version, T& other);
-  void emplace(size_t index, Version version, T&& other);
-
   void erase(size_t index) {
-    if (!_versions[index].exists()) return;
+    if (!contains(index)) return;
+
+    auto& page = *_pages[index >> PAGE_SHIFT];
+    page.ptr(offset(index))->~T();
+    page.versions[offset(index)].destroy();
+    _occupancy.reset(index);
+  }
+
+  // Move the component of Entity index from to the free index to.
+  void relocate(size_t from, size_t to, Version version) {
+    if (!contains(from)) return;
+    assert(!contains(to));
+
+    auto& target = reserve_for(to);
+    detail::move_construct(target.ptr(offset(to)), *ptr(from));
+    target.versions[offset(to)] = version;
+    _occupancy.set(to);
 
-    ptr(index)->~T();
-    _versions[index].destroy();
+    erase(from);
   }
 
+  // Free pages which contain no components.
+  void shrink_to_fit();
 
 private:
   using Slot = detail::Store<T>;
 
-  static constexpr double GROW_RATE = 1.5;
+  static constexpr size_t PAGE_WORDS = PAGE_SIZE / Bitset::WORD_BITS;
 
-  T* ptr(size_t index) {
-    return detail::ptr<T>(_data.get(), index);
-  }
+  struct Page {
+    // User-provided, so the data is left uninitialized by make().
+    Page() {}
 
-  const T* ptr(size_t index) const {
-    return detail::ptr<T>(_data.get(), index);
-  }
+    Version versions[PAGE_SIZE];
+    Slot    data[PAGE_SIZE];
 
-  void reserve_for(size_t index) {
-    if (index < size()) return;
+    T* ptr(size_t offset) {
+      return reinterpret_cast<T*>(data + offset);
+    }
+
+    const T* ptr(size_t offset) const {
+      return reinterpret_cast<const T*>(data + offset);
+    }
+  };
 
-    auto old_size = size();
-    auto new_size = std::max((size_t) std::ceil(GROW_RATE * old_size), index + 1);
+  static size_t offset(size_t index) {
+    return index & (PAGE_SIZE - 1);
+  }
 
-    _versions.resize(new_size);
+  const Page* find_page(size_t index) const {
+    auto page = index >> PAGE_SHIFT;
+    return page < _pages.size() ? _pages[page].get() : nullptr;
+  }
 
-    auto new_data = std::make_unique<Slot[]>(new_size);
-    detail::move<T>(new_data.get(), _data.get(), old_size, _versions);
+  T* ptr(size_t index) {
+    return _pages[index >> PAGE_SHIFT]->ptr(offset(index));
+  }
 
-    _data = std::move(new_data);
+  const T* ptr(size_t index) const {
+    return _pages[index >> PAGE_SHIFT]->ptr(offset(index));
   }
 
-  template<typename... Args>
-  void emplace_without_invalidation_check( size_t    index
-                                         , Version   version
-                                         , Args&&... args)
-  {
-    reserve_for(index);
-
-    if (_versions[index].exists()) {
-      detail::replace(*ptr(index), std::forward<Args>(args)...);
-    } else {
-      new (ptr(index)) T(std::forward<Args>(args)...);
+  Page& reserve_for(size_t index) {
+    auto page = index >> PAGE_SHIFT;
+
+    if (page >= _pages.size()) {
+      _pages.resize(page + 1);
     }
 
-    _versions[index] = version;
-  }
+    if (!_pages[page]) {
+      _pages[page] = allocate_unique<Page>(*_resource);
+    }
 
-  // Is inserting item into the given index going to invalidate the source
-  // pointer?
-  bool will_invalidate(size_t index, const T* source) const {
-    return index >= size() && source >= ptr(0) && source < ptr(size());
+    return *_pages[page];
   }
 
 private:
-
-  std::vector<Version>    _versions;
-  std::unique_ptr<Slot[]> _data;
+  MemoryResource*         _resource;
+  Vector<UniquePtr<Page>> _pages;
+  Bitset                  _occupancy;
 };
 
+// Because existing components are never relocated, it is safe to emplace a
+// component constructed from another component of the same store.
 template<typename T> template<typename... Args>
-void ComponentStore<T>::emplace( size_t    index
+void ComponentStore<T, PagedStorage>::emplace( size_t    index
                                , Version   version
                                , Args&&... args)
 {
-  emplace_without_invalidation_check( index
-                                    , version
-                                    , std::forward<Args>(args)...);
-}
+  auto& page = reserve_for(index);
+  auto  i    = offset(index);
 
-// These overloads are necessary to prevent invalidating the source reference
-// when the target storage has to be reallocated.
-
-template<typename T>
-void ComponentStore<T>::emplace(size_t index, Version version, T& other) {
-  if (will_invalidate(index, &other)) {
-    T temp(other);
-    emplace_without_invalidation_check(index, version, std::move(temp));
+  if (page.versions[i].exists()) {
+    detail::replace(*page.ptr(i), std::forward<Args>(args)...);
   } else {
-    emplace_without_invalidation_check(index, version, other);
+    new (page.ptr(i)) T(std::forward<Args>(args)...);
+    _occupancy.set(index);
   }
+
+  page.versions[i] = version;
 }
 
 template<typename T>
-void ComponentStore<T>::emplace(size_t index, Version version, const T& other) {
-  if (will_invalidate(index, &other)) {
-    T temp(other);
-    emplace_without_invalidation_check(index, version, std::move(temp));
-  } else {
-    emplace_without_invalidation_check(index, version, other);
+void ComponentStore<T, PagedStorage>::shrink_to_fit() {
+  for (size_t p = 0; p < _pages.size(); ++p) {
+    if (!_pages[p]) continue;
+
+    auto empty = true;
+
+    for (size_t i = p * PAGE_WORDS; i < (p + 1) * PAGE_WORDS; ++i) {
+      if (_occupancy.word(i)) {
+        empty = false;
+        break;
+      }
+    }
+
+    if (empty) _pages[p].reset();
   }
-}
 
-template<typename T>
-void ComponentStore<T>::emplace(size_t index, Version version, T&& other) {
-  if (will_invalidate(index, &other)) {
-    T temp(std::move(other));
-    emplace_without_invalidation_check(index, version, std::move(temp));
-  } else {
-    emplace_without_invalidation_check(index, version, std::move(other));
+  while (!_pages.empty() && !_pages.back()) {
+    _pages.pop_back();
   }
+
+  _pages.shrink_to_fit();
+  _occupancy.shrink_to_fit();
 }
 
 } // namespace secs
+
+#include "secs/sparse_set_store.h"
+#include "secs/tag_store.h"
+#include "secs/virtual_store.h"
@@ -1,26 +1,75 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <vector>
 
+#include "secs/archetype_index.h"
+#include "secs/bitset.h"
 #include "secs/component_ops.h"
 #include "secs/component_store.h"
 #include "secs/dynamic_tuple.h"
+#include "secs/entity.h"
+#include "secs/event_queue.h"
+#include "secs/event_router.h"
 #include "secs/event_traits.h"
+#include "secs/group.h"
+#include "secs/memory_resource.h"
+#include "secs/signatures.h"
 #include "secs/signal.h"
 #include "secs/type_keyed_map.h"
 #include "secs/version.h"
 
 namespace secs {
 template<typename> class ComponentPtr;
-class Entity;
 template<typename, typename...> class EntityFilter;
 class EntityView;
+class QueryBase;
+template<typename...> class Query;
 
+namespace detail {
+template<typename, typename...> struct Narrow;
+}
+
+// Engine that the Container uses to answer queries.
+enum class Engine {
+  // Queries test every Entity against the ComponentStores (or walk the owners
+  // of a sparse-set stored component).
+  stores,
+
+  // Entities are additionally grouped into archetype tables by their set of
+  // components, and queries scan only the matching tables.
+  archetypes
+};
+
+// Entity moved to a new index by Container::compact(). The from handle is no
+// longer valid, to refers to the same Entity (and its components).
+struct Relocation {
+  Entity from;
+  Entity to;
+};
+
+// All storage of the Container (Entity versions, ComponentStores, archetype
+// tables, Queries, Signals and their handlers), as well as the result of compact() and the
+// temporary chunks of par_each(), is allocated from a MemoryResource, which
+// must outlive the Container.
 class Container {
 public:
+  Container();
+  explicit Container(Engine engine);
+  explicit Container(MemoryResource& resource);
+  Container(Engine engine, MemoryResource& resource);
+
   ~Container();
 
+  Engine engine() const {
+    return _archetypes ? Engine::archetypes : Engine::stores;
+  }
+
+  MemoryResource& resource() const {
+    return *_resource;
+  }
+
   // Create new Entity.
   Entity create();
 
@@ -37,19 +86,102 @@ public:
 
   Entity get(size_t index);
 
+  // Release memory of the ComponentStores not needed by their components:
+  // empty pages are freed (or decommitted, with VirtualStorage) and spare
+  // capacity is returned.
+  void shrink_to_fit();
+
+  // Move all Entities into a dense range of indices starting at 0, and shrink
+  // the storage. Entities moved to new indices are returned; handles to them
+  // (and ComponentPtrs to their components) become invalid, the new handles
+  // must be used instead. Requires the components to be move constructible.
+  // Must not be called while iterating.
+  Vector<Relocation> compact();
+
+  // Sort the components of type T with compare(const T&, const T&). Queries
+  // requiring T then visit the Entities in that order (adding or removing
+  // components of T disturbs it until the next sort). The components of types
+  // Us are rearranged to follow, so that visiting them along with T is
+  // sequential too. All the types must use SparseSetStorage, and none may be
+  // owned by a Group (std::logic_error is thrown, and nothing is sorted).
+  template<typename T, typename... Us, typename Compare>
+  void sort(Compare compare);
+
+  // Group owning the stores of Ts..., created on first call. Queries for
+  // exactly Ts... then walk the packed components directly. All the types must
+  // use SparseSetStorage, and a type can be part of one group only.
+  template<typename... Ts>
+  Group<Ts...>& group() {
+    auto& result = _groups.get<Group<Ts...>>();
+    if (!result) result.own(store<Ts>()...);
+    return result;
+  }
+
+  // Sort by the key projected from each component by key(const T&).
+  template<typename T, typename... Us, typename Key>
+  void sort_by(Key key) {
+    sort<T, Us...>([&](const T& a, const T& b) { return key(a) < key(b); });
+  }
+
+  // Persistent query for the Entities satisfying the filter Ts..., created and
+  // filled on first call. The Container keeps its list of matching Entities up
+  // to date as components are created and destroyed, which makes structural
+  // changes of the queried types a little slower.
+  template<typename... Ts>
+  Query<Ts...>& query();
+
   // Connect handler to be called when Event of type E is emitted.
   template<typename E, typename F>
   auto connect(F&& f) {
     return _signals.get<Signal<E>>().connect(std::forward<F>(f));
   }
 
+  // Connect components of type T to handle events of type E, which name an
+  // Entity. Each event is delivered only to the connected types its Entity
+  // owns.
   template<typename E, typename T>
   std::enable_if_t<CanHandleEvent<T, E>, Connection>
   connect();
 
+  // Connect handler to be called with batches of events of type E, as
+  // Span<const E>. Single events come as batches of one.
+  template<typename E, typename F>
+  auto connect_batch(F&& f) {
+    return _signals.get<Signal<E>>().connect_batch(std::forward<F>(f));
+  }
+
+  // Emit the event to the connected handlers. Signals are created by the first
+  // connect(), so emitting an event nobody connected to does nothing.
   template<typename E>
   void emit(const E& event) const {
-    _signals.get<Signal<E>>()(event);
+    if (auto signal = _signals.find<Signal<E>>()) (*signal)(event);
+  }
+
+  // Queue the event to be emitted by the next dispatch(). Events of each type
+  // are stored contiguously and delivered in one batch.
+  template<typename E>
+  void enqueue(E&& event);
+
+  // Emit all queued events, type by type in order of their first enqueue(),
+  // until no events are left (handlers may enqueue more). Calling dispatch()
+  // from a handler does nothing: the outer dispatch() delivers the events.
+  // An exception thrown by a handler propagates out of dispatch(): the rest
+  // of the batch being delivered is dropped, events of other types stay
+  // queued for the next dispatch().
+  void dispatch();
+
+  // Emit the events to each handler in one call per handler.
+  template<typename E>
+  void emit_batch(Span<const E> events) const {
+    if (auto signal = _signals.find<Signal<E>>()) signal->emit_batch(events);
+  }
+
+  // Test that a handler is connected to events of type E. Used to skip
+  // building events nobody listens to.
+  template<typename E>
+  bool listening() const {
+    auto signal = _signals.find<Signal<E>>();
+    return signal && !signal->empty();
   }
 
 private:
@@ -62,7 +194,18 @@ private:
   }
 
   bool contains(size_t index) const {
-    return index < _versions.size() && _versions[index].exists();
+    return _occupancy.test(index);
+  }
+
+  // Incremented on every structural change: creation or destruction of an
+  // Entity or a Component.
+  size_t generation() const {
+    return _generation;
+  }
+
+  // Bit per Entity index, set if the Entity exists.
+  const Bitset& occupancy() const {
+    return _occupancy;
   }
 
   bool contains(size_t index, Version version) const {
@@ -81,27 +224,118 @@ private:
     return std::make_tuple(&_stores.get<ComponentStore<Ts>>()...);
   }
 
+  // Index of the component type T in this Container. The indices are
+  // assigned on first use, densely from 0, and identify the types in the
+  // signatures, the archetypes and the routes of events.
+  template<typename T>
+  size_t type_index() {
+    auto& index = _type_indices.get<T>();
+
+    if (index == 0) {
+      _ops.emplace_back();
+      index = _ops.size();
+    }
+
+    return index - 1;
+  }
+
+  // Count of moves of Entities between archetype tables, and whether the
+  // Entity moved after the given count. Without the archetype engine nothing
+  // moves.
+  size_t archetype_moves() const {
+    return _archetypes ? _archetypes->moves() : 0;
+  }
+
+  bool moved_since(size_t index, size_t moves) const {
+    return _archetypes && _archetypes->moved_since(index, moves);
+  }
+
+  // Archetype tables including all the required component types and none of
+  // the excluded ones, or null if the archetype engine is not used.
+  const ArchetypeIndex::Tables* match( const Bitset& required
+                                     , const Bitset& excluded)
+  {
+    return _archetypes ? &_archetypes->match(required, excluded) : nullptr;
+  }
+
+  // Notify the queries interested in the component type that the Entity gained
+  // or lost a component of it.
+  void update_queries(size_t type, size_t index);
+
   template<typename T, typename... Args>
   ComponentPtr<T> create_component(const Entity&, Args&&... args);
 
   template<typename T>
   void destroy_component(const Entity&);
 
+  template<typename T>
+  void relocate_component(const Entity& source, const Entity& target);
+
   void copy(const Entity& source, const Entity& target);
+  void relocate(size_t from, size_t to);
+
+  template<typename E>
+  static bool flush_queue(Container&, void* queue);
+
+  template<typename E>
+  void route(const EventRouter<E>&, Span<const E> events);
+
+  template<typename E, typename T>
+  static void route_to(Container&, size_t index, const E& event);
 
 private:
+  MemoryResource*             _resource;
+
   size_t                      _capacity = 0;
-  std::vector<size_t>         _holes;
-  std::vector<Version>        _versions;
+  Vector<size_t>              _holes;
+  Vector<Version>             _versions;
+
+  // Upper bound of versions of indices released by compact(), so that stale
+  // handles to them never match new Entities.
+  Version                     _retired;
+  Bitset                      _occupancy;
+  Signatures                  _signatures;
+  size_t                      _generation = 0;
 
   DynamicTuple                _stores;
-  TypeKeyedMap<ComponentOps>  _ops;
+  DynamicTuple                _groups;
+
+  // Type index + 1 per type_id (0 if not assigned), and the operations of
+  // each component type by type index. Like the DynamicTuples, the map is
+  // sized by the largest type_id of a component type, which is one word per
+  // type used in the program.
+  TypeKeyedMap<size_t>        _type_indices;
+  Vector<ComponentOps>        _ops;
+
+  // Queries, in order of creation and per type index of the component types
+  // they filter by.
+  DynamicTuple                _queries;
+  Vector<QueryBase*>          _query_order;
+  Vector<Vector<QueryBase*>>  _query_types;
 
   DynamicTuple                _signals;
 
+  // EventRouter per event type, connected to its Signal. Declared after the
+  // signals to disconnect from them on destruction.
+  DynamicTuple                _routers;
+
+  // Queue per type of enqueued events, and the queues in order of creation.
+  struct Queue {
+    void* queue;
+    bool (*flush)(Container&, void*);
+  };
+
+  DynamicTuple                _queues;
+  Vector<Queue>               _queue_order;
+  bool                        _dispatching = false;
+
+  UniquePtr<ArchetypeIndex>   _archetypes;
+
+  friend class ComponentOps;
   friend class Entity;
   template<typename, typename...> friend class EntityFilter;
   friend class EntityView;
+  template<typename, typename...> friend struct detail::Narrow;
 };
 
 } // namespace secs
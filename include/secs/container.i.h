@@ -1,10 +1,13 @@
 #pragma once
 
+#include <stdexcept>
+
 #include "secs/entity.h"
 #include "secs/container.h"
 #include "secs/entity_filter.h"
 #include "secs/entity_view.h"
 #include "secs/lifetime_events.h"
+#include "secs/query.h"
 
 namespace secs {
 namespace detail {
@@ -72,14 +75,34 @@ template<typename T, typename... Args>
 ComponentPtr<T> Container::create_component( const Entity& entity
                                            , Args&&...     args)
 {
-  _ops.get<T>().template setup<T>();
+  auto type = type_index<T>();
+  _ops[type].template setup<T>();
 
   auto& s = store<T>();
+  auto  replaced = s.contains(entity._index);
+
+  detail::bind(s, _versions);
+
   s.emplace(entity._index, entity._version, std::forward<Args>(args)...);
 
+  if (!replaced) {
+    _signatures.set(entity._index, type);
+    detail::group_added(s, entity._index);
+    ++_generation;
+
+    if (_archetypes) {
+      _archetypes->add(entity._index, type);
+    }
+
+    update_queries(type, entity._index);
+  }
+
   ComponentPtr<T> component(s, entity._index, entity._version);
   detail::invoke_on_create(entity, *component);
-  emit(OnCreate<T>{ entity, component });
+
+  if (listening<OnCreate<T>>()) {
+    emit(OnCreate<T>{ entity, component });
+  }
 
   return component;
 }
@@ -91,9 +114,137 @@ void Container::destroy_component(const Entity& entity) {
 
   ComponentPtr<T> component(s, entity._index, entity._version);
   detail::invoke_on_destroy(entity, *component);
-  emit(OnDestroy<T>{ entity, component });
 
+  if (listening<OnDestroy<T>>()) {
+    emit(OnDestroy<T>{ entity, component });
+  }
+
+  auto type = type_index<T>();
+
+  detail::group_removed(s, entity._index);
   s.erase(entity._index);
+  _signatures.reset(entity._index, type);
+  ++_generation;
+
+  if (_archetypes) {
+    _archetypes->remove(entity._index, type);
+  }
+
+  update_queries(type, entity._index);
+}
+
+template<typename... Ts>
+Query<Ts...>& Container::query() {
+  auto& result = _queries.get<Query<Ts...>>();
+  if (result) return result;
+
+  result.bind(*this, store_ptrs<detail::ComponentType<Ts>...>());
+  _query_order.push_back(&result);
+
+  for (auto type : { type_index<detail::ComponentType<Ts>>()... }) {
+    // Emplaced one by one, to allocate the lists from the resource too.
+    while (type >= _query_types.size()) _query_types.emplace_back(*_resource);
+    _query_types[type].push_back(&result);
+  }
+
+  for (auto entity : entities<Ts...>()) {
+    result.update(Entity(entity)._index);
+  }
+
+  return result;
+}
+
+template<typename E>
+void Container::enqueue(E&& event) {
+  using Event = std::decay_t<E>;
+
+  auto queue = _queues.find<EventQueue<Event>>();
+
+  if (!queue) {
+    queue = &_queues.get<EventQueue<Event>>();
+    _queue_order.push_back({ queue, &flush_queue<Event> });
+  }
+
+  queue->push(std::forward<E>(event));
+}
+
+template<typename E>
+bool Container::flush_queue(Container& container, void* queue) {
+  return static_cast<EventQueue<E>*>(queue)->flush(
+      container._signals.find<Signal<E>>());
+}
+
+template<typename E>
+void Container::route(const EventRouter<E>& router, Span<const E> events) {
+  using secs::event_entity;
+
+  for (auto& event : events) {
+    Entity entity = event_entity(event);
+    if (!entity) continue;
+
+    auto& container = *entity._container;
+    auto  index     = entity._index;
+
+    // The routes are indexed by the type indices of this Container, so for
+    // Entities of other Containers every routed type is tried (the handles
+    // skip the types the Entity does not own).
+    if (&container != this) {
+      auto& types = router.types();
+
+      for (size_t w = 0; w < types.word_count() && entity; ++w) {
+        for (auto bits = types.word(w); bits && entity; bits &= bits - 1) {
+          auto type = w * Bitset::WORD_BITS + lowest_bit(bits);
+          router.handle(container, type, index, event);
+        }
+      }
+
+      continue;
+    }
+
+    container._signatures.each(index, router.types(), [&](size_t type) {
+      // Earlier handlers may have destroyed the component or the Entity.
+      if (entity && container._signatures.test(index, type)) {
+        router.handle(container, type, index, event);
+      }
+    });
+  }
+}
+
+template<typename E, typename T>
+void Container::route_to(Container& container, size_t index, const E& event) {
+  using secs::event_handle;
+
+  auto& store = container.store<T>();
+  if (store.contains(index)) event_handle(store.get(index), event);
+}
+
+template<typename T, typename... Us, typename Compare>
+void Container::sort(Compare compare) {
+  static_assert( AllOf<IsSparseSetStored<T>, IsSparseSetStored<Us>...>
+               , "sort requires SparseSetStorage");
+
+  // Sorting would break the packed prefix of the group.
+  bool grouped = false;
+
+  int check[] = { 0, (grouped = grouped || store<Us>().group(), 0)... };
+  (void) check;
+
+  if (grouped || store<T>().group()) {
+    throw std::logic_error("Sorting components owned by a Group");
+  }
+
+  auto& leader = store<T>();
+  leader.sort(compare);
+
+  int expand[] = { 0, (store<Us>().follow(leader), 0)... };
+  (void) expand;
+
+  ++_generation;
+}
+
+template<typename T>
+void Container::relocate_component(const Entity& source, const Entity& target) {
+  store<T>().relocate(source._index, target._index, target._version);
 }
 
 } // namespace secs
@@ -101,14 +252,13 @@ void Container::destroy_component(const Entity& entity) {
 template<typename E, typename T>
 std::enable_if_t<secs::CanHandleEvent<T, E>, secs::Connection>
 secs::Container::connect() {
-  using secs::event_entity;
-  using secs::event_handle;
+  auto& router = _routers.get<EventRouter<E>>();
 
-  return connect<E>([](auto& event) {
-    if (auto entity = event_entity(event)) {
-      if (auto component = entity.template component<T>()) {
-        event_handle(*component, event);
-      }
-    }
-  });
+  if (!router.slot().connected()) {
+    router.slot() = connect_batch<E>([this, &router](Span<const E> events) {
+      route(router, events);
+    });
+  }
+
+  return router.add(type_index<T>(), &route_to<E, T>);
 }
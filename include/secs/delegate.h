@@ -0,0 +1,202 @@
+#pragma once
+
+// Type-erased callable with inline storage.
+//
+// Delegate is a lightweight replacement for std::function. Callables which fit
+// into the inline buffer of Size bytes (and are nothrow move constructible) are
+// stored inside the Delegate itself, so creating one does not allocate. Bigger
+// callables are allocated from a MemoryResource, which is the new-delete
+// resource unless given to assign_in(); the storage is the same as BasicAny's.
+// Calling a Delegate is a single indirect call.
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "secs/inline_storage.h"
+#include "secs/memory_resource.h"
+
+namespace secs {
+
+template<typename Signature, size_t Size = 3 * sizeof(void*)>
+class Delegate;
+
+template<typename R, typename... Args, size_t Size>
+class Delegate<R(Args...), Size> {
+private:
+  static_assert( Size >= sizeof(detail::HeapValue)
+               , "The buffer must fit a pointer and its resource");
+
+  using Buffer = detail::InlineBuffer<Size>;
+  using Heap   = detail::HeapValue;
+
+  template<typename F, typename Result = void>
+  using disable_if_self = std::enable_if_t<
+    !std::is_same<std::decay_t<F>, Delegate>::value, Result>;
+
+  enum class Op { MOVE, DESTROY };
+
+  using Call   = R (*)(void*, Args...);
+  using Manage = void (*)(Op, void* from, void* to);
+
+  template<typename F>
+  struct Inline {
+    static R call(void* buffer, Args... args) {
+      return (*reinterpret_cast<F*>(buffer))(std::forward<Args>(args)...);
+    }
+
+    static void manage(Op op, void* from, void* to) {
+      auto& fun = *reinterpret_cast<F*>(from);
+
+      if (op == Op::MOVE) {
+        new (to) F(std::move(fun));
+      }
+
+      fun.~F();
+    }
+
+    // Trivial callables are moved by copying the buffer.
+    static constexpr Manage manager() {
+      return std::is_trivially_copyable<F>::value ? nullptr : &manage;
+    }
+
+    template<typename G>
+    static void construct(void* buffer, MemoryResource&, G&& fun) {
+      new (buffer) F(std::forward<G>(fun));
+    }
+  };
+
+  template<typename F>
+  struct Allocated {
+    static R call(void* buffer, Args... args) {
+      return Heap::get<F>(buffer)(std::forward<Args>(args)...);
+    }
+
+    static void manage(Op op, void* from, void* to) {
+      if (op == Op::MOVE) {
+        new (to) Heap(*static_cast<Heap*>(from));
+      } else {
+        Heap::destroy<F>(from);
+      }
+    }
+
+    static constexpr Manage manager() {
+      return &manage;
+    }
+
+    template<typename G>
+    static void construct(void* buffer, MemoryResource& resource, G&& fun) {
+      Heap::construct<F>(buffer, resource, std::forward<G>(fun));
+    }
+  };
+
+public:
+  // Whether callables of type F are stored in the inline buffer.
+  template<typename F>
+  static constexpr bool is_inline() {
+    return detail::stores_inline<F, Size>();
+  }
+
+  Delegate() = default;
+  Delegate(std::nullptr_t) {}
+
+  template<typename F>
+  Delegate(F&& fun, disable_if_self<F, void*> = nullptr) {
+    construct(*new_delete_resource(), std::forward<F>(fun));
+  }
+
+  Delegate(const Delegate&) = delete;
+
+  Delegate(Delegate&& other) noexcept {
+    take(other);
+  }
+
+  ~Delegate() {
+    reset();
+  }
+
+  Delegate& operator = (const Delegate&) = delete;
+
+  Delegate& operator = (Delegate&& other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+
+    return *this;
+  }
+
+  Delegate& operator = (std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  template<typename F>
+  disable_if_self<F, Delegate&> operator = (F&& fun) {
+    assign_in(*new_delete_resource(), std::forward<F>(fun));
+    return *this;
+  }
+
+  // Store the callable, in memory allocated from the resource unless it is
+  // stored inline.
+  template<typename F>
+  void assign_in(MemoryResource& resource, F&& fun) {
+    reset();
+    construct(resource, std::forward<F>(fun));
+  }
+
+  explicit operator bool () const {
+    return _call != nullptr;
+  }
+
+  R operator () (Args... args) const {
+    assert(_call);
+    return _call(&_buffer, std::forward<Args>(args)...);
+  }
+
+  void reset() {
+    if (_manage) _manage(Op::DESTROY, &_buffer, nullptr);
+
+    _call   = nullptr;
+    _manage = nullptr;
+  }
+
+private:
+  template<typename F>
+  void construct(MemoryResource& resource, F&& fun) {
+    using G       = std::decay_t<F>;
+    using Storage = std::conditional_t< is_inline<G>()
+                                      , Inline<G>
+                                      , Allocated<G>>;
+
+    Storage::construct(&_buffer, resource, std::forward<F>(fun));
+    _call   = &Storage::call;
+    _manage = Storage::manager();
+  }
+
+  void take(Delegate& other) {
+    if (!other) return;
+
+    if (other._manage) {
+      other._manage(Op::MOVE, &other._buffer, &_buffer);
+    } else {
+      std::memcpy(&_buffer, &other._buffer, sizeof(Buffer));
+    }
+
+    _call   = other._call;
+    _manage = other._manage;
+
+    other._call   = nullptr;
+    other._manage = nullptr;
+  }
+
+private:
+  mutable Buffer _buffer;
+  Call           _call   = nullptr;
+  Manage         _manage = nullptr;
+};
+
+} // namespace secs
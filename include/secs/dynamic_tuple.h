@@ -1,31 +1,71 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <tuple>
-#include "secs/any.h"
+#include <type_traits>
+#include "secs/memory_resource.h"
 #include "secs/type_indexer.h"
 
 // Tuple with dynamic number of elements. Can contain at most one element per
-// type. The types stored in it must be default-constructible.
+// type. The types stored in it must be default-constructible, or constructible
+// from a MemoryResource&, in which case they are given the resource of the
+// tuple.
+//
+// The elements are placed next to each other in blocks allocated from the
+// resource, and are never moved, so references to them stay valid for the
+// lifetime of the tuple. They are looked up by type_id in a table of pointers,
+// which therefore has a slot (two pointers) for every type id up to the
+// largest one stored: its size grows with the number of types used in the
+// whole program, not only with the elements of the tuple. For a few hundred
+// types that is a few kilobytes per tuple, in exchange for a lookup of a single
+// load.
 
 namespace secs {
 
 class DynamicTuple {
 public:
+  DynamicTuple()
+    : DynamicTuple(*new_delete_resource())
+  {}
+
+  explicit DynamicTuple(MemoryResource& resource)
+    : _resource(&resource)
+    , _arena(BLOCK_SIZE, resource)
+    , _slots(resource)
+    , _order(resource)
+  {
+    _order.reserve(16);
+  }
+
+  ~DynamicTuple();
+
+  DynamicTuple(const DynamicTuple&) = delete;
+  DynamicTuple& operator = (const DynamicTuple&) = delete;
+
   template<typename T>
   T& get() const {
-    auto index = _type_indexer.get<T>();
+    auto index = type_id<T>();
 
-    if (index >= _store.size()) {
-      _store.resize(index + 1);
+    if (index < _slots.size() && _slots[index].object) {
+      assert(_slots[index].destroy == &destroy<T>);
+      return *static_cast<T*>(_slots[index].object);
     }
 
-    if (!_store[index]) {
-      _store[index].template emplace<T>();
-    } else {
-      assert(_store[index].template contains<T>());
+    return create<T>(index);
+  }
+
+  // Pointer to the element of type T, or nullptr if it was not created yet.
+  template<typename T>
+  T* find() const {
+    auto index = type_id<T>();
+
+    if (index < _slots.size() && _slots[index].object) {
+      assert(_slots[index].destroy == &destroy<T>);
+      return static_cast<T*>(_slots[index].object);
     }
 
-    return _store[index].template get<T>();
+    return nullptr;
   }
 
   template<typename... Ts>
@@ -34,8 +74,62 @@ public:
   }
 
 private:
-  TypeIndexer              _type_indexer;
-  mutable std::vector<Any> _store;
+  static constexpr size_t BLOCK_SIZE = 2048;
+
+  using Destroy = void (*)(void*);
+
+  struct Slot {
+    void*   object  = nullptr;
+    Destroy destroy = nullptr;
+  };
+
+  template<typename T>
+  static void destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  template<typename T>
+  T& create(size_t index) const {
+    if (index >= _slots.size()) {
+      _slots.resize(std::max(index + 1, 2 * _slots.size()));
+    }
+
+    auto object = construct<T>(_arena.allocate(sizeof(T), alignof(T)));
+
+    _slots[index] = { object, &destroy<T> };
+    _order.push_back(index);
+
+    return *object;
+  }
+
+  template<typename T>
+  std::enable_if_t<std::is_constructible<T, MemoryResource&>::value, T*>
+  construct(void* memory) const {
+    return new (memory) T(*_resource);
+  }
+
+  template<typename T>
+  std::enable_if_t<!std::is_constructible<T, MemoryResource&>::value, T*>
+  construct(void* memory) const {
+    return new (memory) T();
+  }
+
+private:
+  MemoryResource*           _resource;
+  mutable MonotonicResource _arena;
+
+  // Indexed by type_id, up to the largest one of the elements.
+  mutable Vector<Slot>      _slots;
+
+  // Indices of the elements in order of creation, to destroy them in reverse.
+  mutable Vector<size_t>    _order;
 };
 
-} // namespace secs
\ No newline at end of file
+inline DynamicTuple::~DynamicTuple() {
+  for (auto i = _order.size(); i > 0; --i) {
+    auto& slot = _slots[_order[i - 1]];
+    slot.destroy(slot.object);
+  }
+}
+
+} // namespace secs
@@ -12,6 +12,10 @@ template<typename> class ComponentPtr;
 class Container;
 template<typename...> class FilteredEntity;
 
+namespace detail {
+template<typename, typename...> struct SeekEach;
+}
+
 class Entity {
 public:
   Entity()
@@ -71,6 +75,7 @@ private:
   friend class Container;
   template<typename, typename...> friend class EntityFilter;
   template<typename...> friend class FilteredEntity;
+  template<typename, typename...> friend struct detail::SeekEach;
 
   friend bool operator == (const Entity&, const Entity&);
   friend bool operator < (const Entity&, const Entity&);
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <tuple>
+#include <utility>
+
+#include "secs/entity_view.h"
 #include "secs/filtered_entity.h"
 #include "secs/functional.h"
+#include "secs/query_kernel.h"
+#include "secs/span.h"
+#include "secs/thread_pool.h"
 
 namespace secs {
 
@@ -11,10 +18,15 @@ template<typename> struct Optional {};
 // Mark component types that are required (this is the default).
 template<typename> struct Required {};
 
+// Mark component types the Entities must not have. Excluded components are not
+// passed to each().
+template<typename> struct Without {};
+
 namespace detail {
 template<typename T> struct ComponentTypeImpl              { using type = T; };
 template<typename T> struct ComponentTypeImpl<Optional<T>> { using type = T; };
 template<typename T> struct ComponentTypeImpl<Required<T>> { using type = T; };
+template<typename T> struct ComponentTypeImpl<Without<T>>  { using type = T; };
 
 template<typename T>
 using ComponentType = typename ComponentTypeImpl<T>::type;
@@ -26,6 +38,37 @@ template<typename T> struct ComponentArgImpl<Required<T>> { using type = T&; };
 template<typename T>
 using ComponentArg = typename ComponentArgImpl<T>::type;
 
+template<typename T> constexpr bool IsRequired              = true;
+template<typename T> constexpr bool IsRequired<Optional<T>> = false;
+template<typename T> constexpr bool IsRequired<Without<T>>  = false;
+
+template<typename T> constexpr bool IsExcluded              = false;
+template<typename T> constexpr bool IsExcluded<Without<T>>  = true;
+
+// Arguments passed to each() for the component: none for excluded ones.
+template<typename T> struct ComponentArgsImpl {
+  using type = std::tuple<ComponentArg<T>>;
+};
+
+template<typename T> struct ComponentArgsImpl<Without<T>> {
+  using type = std::tuple<>;
+};
+
+template<typename... Ts>
+using ComponentArgs = decltype(std::tuple_cat(
+  std::declval<typename ComponentArgsImpl<Ts>::type>()...));
+
+template<typename F, typename Args> struct IsCallableWithImpl;
+
+template<typename F, typename... Args>
+struct IsCallableWithImpl<F, std::tuple<Args...>> {
+  static constexpr bool value = IsCallable<F, Args...>;
+};
+
+// Test if F can be called with the elements of the tuple Args.
+template<typename F, typename Args>
+constexpr bool IsCallableWith = IsCallableWithImpl<F, Args>::value;
+
 template<typename... Ts>
 using ComponentStores = std::tuple<ComponentStore<ComponentType<Ts>>*...>;
 
@@ -53,6 +96,14 @@ template<typename T> struct SatisfiesOne<Optional<T>> {
   }
 };
 
+template<typename T> struct SatisfiesOne<Without<T>> {
+  bool operator () ( const ComponentStore<ComponentType<T>>& store
+                   , size_t                                  index) const
+  {
+    return !store.contains(index);
+  }
+};
+
 template<typename...> struct SatisfiesAll;
 
 template<typename T, typename... Ts> struct SatisfiesAll<T, Ts...> {
@@ -78,6 +129,311 @@ bool satisfies(const ComponentStores<Ts...>& stores, size_t index) {
   return SatisfiesAll<Ts...>()(stores, index);
 }
 
+// Word of the bitset of Entity indices satisfying the filter.
+template<typename T> struct MaskOne {
+  Bitset::Word operator () ( const ComponentStore<ComponentType<T>>& store
+                           , size_t                                  word) const
+  {
+    return store.occupancy().word(word);
+  }
+};
+
+template<typename T> struct MaskOne<Optional<T>> {
+  Bitset::Word operator () (const ComponentStore<ComponentType<T>>&, size_t) const {
+    return ~Bitset::Word(0);
+  }
+};
+
+template<typename T> struct MaskOne<Without<T>> {
+  Bitset::Word operator () ( const ComponentStore<ComponentType<T>>& store
+                           , size_t                                  word) const
+  {
+    return ~store.occupancy().word(word);
+  }
+};
+
+template<typename... Ts>
+Bitset::Word mask(const ComponentStores<Ts...>& stores, size_t word) {
+  Bitset::Word result = ~Bitset::Word(0);
+
+  int expand[] = { 0, (result &= MaskOne<Ts>()(
+    *std::get<ComponentStore<ComponentType<Ts>>*>(stores), word), 0)... };
+  (void) expand;
+  (void) word;
+
+  return result;
+}
+
+template<typename... Ts>
+constexpr size_t RequiredCount = 0;
+
+template<typename T, typename... Ts>
+constexpr size_t RequiredCount<T, Ts...> = (IsRequired<T> ? 1 : 0)
+                                         + RequiredCount<Ts...>;
+
+template<typename... Ts>
+constexpr size_t ExcludedCount = 0;
+
+template<typename T, typename... Ts>
+constexpr size_t ExcludedCount<T, Ts...> = (IsExcluded<T> ? 1 : 0)
+                                         + ExcludedCount<Ts...>;
+
+// Components passed to EntityFilter::each_chunk() without a span: excluded
+// ones, and tags, whose components are all one shared object.
+template<typename T>
+constexpr bool HasNoSpan = IsExcluded<T> || IsTagStored<ComponentType<T>>;
+
+template<typename... Ts>
+constexpr size_t SpanCount = 0;
+
+template<typename T, typename... Ts>
+constexpr size_t SpanCount<T, Ts...> = (HasNoSpan<T> ? 0 : 1)
+                                     + SpanCount<Ts...>;
+
+// Fill out with the given bitset of existing Entities and the occupancy
+// bitsets of the stores of the required components.
+template<typename... Ts>
+void required_operands( const Bitset&                 entities
+                      , const ComponentStores<Ts...>& stores
+                      , Operand*                      out)
+{
+  size_t n = 0;
+  out[n++] = operand(entities);
+
+  int expand[] = { 0, (IsRequired<Ts>
+    ? (out[n++] = operand(
+        std::get<ComponentStore<ComponentType<Ts>>*>(stores)->occupancy()), 0)
+    : 0)... };
+  (void) expand;
+}
+
+// Fill out with the occupancy bitsets of the stores of the excluded
+// components.
+template<typename... Ts>
+void excluded_operands(const ComponentStores<Ts...>& stores, Operand* out) {
+  size_t n = 0;
+
+  int expand[] = { 0, (IsExcluded<Ts>
+    ? (out[n++] = operand(
+        std::get<ComponentStore<ComponentType<Ts>>*>(stores)->occupancy()), 0)
+    : 0)... };
+  (void) expand;
+  (void) out;
+}
+
+// Queries of only required sparse-set stored components can be answered by a
+// Group owning exactly their stores.
+template<typename... Ts>
+constexpr bool Groupable = sizeof...(Ts) > 0
+  && AllOf<(IsRequired<Ts> && IsSparseSetStored<ComponentType<Ts>>)...>;
+
+template<typename... Ts>
+const GroupBase* find_group(const ComponentStores<Ts...>&, std::false_type) {
+  return nullptr;
+}
+
+template<typename... Ts>
+const GroupBase* find_group(const ComponentStores<Ts...>& stores, std::true_type) {
+  const GroupBase* groups[] = {
+    (std::get<ComponentStore<ComponentType<Ts>>*>(stores)
+      ? std::get<ComponentStore<ComponentType<Ts>>*>(stores)->group()
+      : nullptr)... };
+
+  auto result = groups[0];
+  if (!result || result->arity() != sizeof...(Ts)) return nullptr;
+
+  for (auto group : groups) {
+    if (group != result) return nullptr;
+  }
+
+  return result;
+}
+
+// Group owning exactly the stores of Ts..., if any.
+template<typename... Ts>
+const GroupBase* common_group(const ComponentStores<Ts...>& stores) {
+  return find_group<Ts...>(
+    stores, std::integral_constant<bool, Groupable<Ts...>>());
+}
+
+// Advance the source iterator to the first Entity satisfying the filter,
+// testing one Entity at a time.
+template<typename I, typename... Ts> struct SeekEach {
+  void operator () ( I&                            source
+                   , const I&                      end
+                   , const ComponentStores<Ts...>& stores
+                   , size_t                        offset) const
+  {
+    for (source += offset; source != end; ++source) {
+      if (satisfies<Ts...>(stores, (*source)._index)) return;
+    }
+  }
+};
+
+template<typename I, typename... Ts> struct Seek : SeekEach<I, Ts...> {};
+
+// Iterating all Entities in a Container can test 64 Entities at a time
+// against the occupancy bitsets of the stores.
+template<typename... Ts> struct Seek<EntityView::Iterator, Ts...> {
+  void operator () ( EntityView::Iterator&         source
+                   , const EntityView::Iterator&   end
+                   , const ComponentStores<Ts...>& stores
+                   , size_t                        offset) const
+  {
+    if (source.seekable()) {
+      source.seek(offset, [&](size_t word) {
+        return mask<Ts...>(stores, word);
+      });
+    } else {
+      SeekEach<EntityView::Iterator, Ts...>()(source, end, stores, offset);
+    }
+  }
+};
+
+// Dense index array of a sparse-set stored component, with the stamps of its
+// positions.
+struct DenseTable {
+  const Vector<uint32_t>* indices = nullptr;
+  const MoveStamps*       moves   = nullptr;
+
+  explicit operator bool () const {
+    return indices != nullptr;
+  }
+
+  size_t size() const {
+    return indices->size();
+  }
+};
+
+// Find the dense index array of the required sparse-set stored component with
+// the fewest owners (the first sorted one, if sorted_only is set), to drive the
+// iteration over a Container with.
+template<typename T, bool = IsSparseSetStored<ComponentType<T>>>
+struct DriverOne {
+  template<typename S>
+  DenseTable operator () (const S& store, bool sorted_only) const {
+    if (sorted_only && !store.sorted()) return {};
+    return { &store.indices(), &store.moves() };
+  }
+};
+
+template<typename T> struct DriverOne<T, false> {
+  template<typename S>
+  DenseTable operator () (const S&, bool) const {
+    return {};
+  }
+};
+
+template<typename T> struct DriverOne<Optional<T>, true> {
+  template<typename S>
+  DenseTable operator () (const S&, bool) const {
+    return {};
+  }
+};
+
+template<typename T> struct DriverOne<Without<T>, true> {
+  template<typename S>
+  DenseTable operator () (const S&, bool) const {
+    return {};
+  }
+};
+
+template<typename...> struct Driver;
+
+template<typename T, typename... Ts> struct Driver<T, Ts...> {
+  template<typename U>
+  DenseTable operator () (const U& stores, bool sorted_only) const {
+    using Store = ComponentStore<ComponentType<T>>;
+
+    auto first = DriverOne<T>()(*std::get<Store*>(stores), sorted_only);
+    if (first && sorted_only) return first;
+
+    auto rest = Driver<Ts...>()(stores, sorted_only);
+    if (!first) return rest;
+    if (!rest)  return first;
+
+    return rest.size() < first.size() ? rest : first;
+  }
+};
+
+template<> struct Driver<> {
+  template<typename U>
+  DenseTable operator () (const U&, bool) const {
+    return {};
+  }
+};
+
+// Narrow the source range to the smallest sequence of Entities which can
+// satisfy the filter. Only Containers can be narrowed.
+//
+// Only sparse-set stored components, Groups and archetype tables have lists of
+// their owners. A query whose rarest required component uses PagedStorage (the
+// default) is not narrowed with the stores engine: iterating it scans the
+// occupancy bitsets of the whole Container, O(capacity / 64) words, however
+// few Entities match.
+template<typename R, typename... Ts> struct Narrow {
+  const R& operator () (const R& source, const ComponentStores<Ts...>&) const {
+    return source;
+  }
+};
+
+template<typename... Ts> struct Narrow<EntityView, Ts...> {
+  EntityView operator () ( const EntityView&              source
+                         , const ComponentStores<Ts...>& stores) const
+  {
+    auto& container = *get_container(source);
+
+    // The Entities packed by a Group owning exactly the queried stores. Their
+    // positions are the same in all the stores.
+    if (auto group = common_group<Ts...>(stores)) {
+      auto packed = Driver<Ts...>()(stores, false);
+      return { container, *packed.indices, packed.moves, group };
+    }
+
+    // Sorted components are visited in their order.
+    if (auto sorted = Driver<Ts...>()(stores, true)) {
+      return { container, *sorted.indices, sorted.moves };
+    }
+
+    auto subset = Driver<Ts...>()(stores, false);
+
+    // The archetype tables are used unless the rarest sparse-set stored
+    // component has fewer owners.
+    if (container.engine() == Engine::archetypes) {
+      Bitset required;
+      Bitset excluded;
+
+      int expand[] = { 0, (IsRequired<Ts> || IsExcluded<Ts>
+        ? ((IsRequired<Ts> ? required : excluded).set(
+             container.template type_index<ComponentType<Ts>>()), 0)
+        : 0)... };
+      (void) expand;
+
+      if (!required.none()) {
+        auto& tables = *container.match(required, excluded);
+
+        size_t rows = 0;
+        for (auto table : tables) rows += table->size();
+
+        if (!subset || rows <= subset.size()) {
+          return { container, tables };
+        }
+      }
+    }
+
+    if (subset) {
+      return { container, *subset.indices, subset.moves };
+    } else {
+      return source;
+    }
+  }
+};
+
+template<typename... Ts, typename R>
+decltype(auto) narrow(const R& source, const ComponentStores<Ts...>& stores) {
+  return Narrow<R, Ts...>()(source, stores);
+}
+
 template<typename C, typename E>
 struct GetComponent {
   decltype(auto) operator () (const E& entity) const {
@@ -97,6 +453,37 @@ decltype(auto) get_component(const E& entity) {
   return GetComponent<C, E>()(entity);
 }
 
+// Tuple of the arguments passed to each() for the component.
+template<typename C, typename E>
+struct GetComponentArgs {
+  typename ComponentArgsImpl<C>::type operator () (const E& entity) const {
+    return typename ComponentArgsImpl<C>::type(get_component<C>(entity));
+  }
+};
+
+template<typename C, typename E>
+struct GetComponentArgs<Without<C>, E> {
+  std::tuple<> operator () (const E&) const {
+    return {};
+  }
+};
+
+template<typename F, typename Args, size_t... Is>
+void apply(F& f, Args&& args, std::index_sequence<Is...>) {
+  f(std::get<Is>(std::forward<Args>(args))...);
+}
+
+// Call f with the prefix arguments followed by the components of the Entity,
+// leaving out the excluded ones.
+template<typename... Ts, typename F, typename E, typename... Prefix>
+void call_with_components(F& f, const E& entity, Prefix&&... prefix) {
+  auto args = std::tuple_cat( std::forward_as_tuple(prefix...)
+                            , GetComponentArgs<Ts, E>()(entity)...);
+
+  apply( f, std::move(args)
+       , std::make_index_sequence<std::tuple_size<decltype(args)>::value>());
+}
+
 } // namespace detail
 
 template<typename R> Container* get_container(const R&);
@@ -108,6 +495,12 @@ class EntityFilter {
 public:
   using value_type = FilteredEntity<detail::ComponentType<Ts>...>;
 
+private:
+  // Arguments of the function passed to each(), without and with the Entity.
+  using Args           = detail::ComponentArgs<Ts...>;
+  using ArgsWithEntity = decltype(std::tuple_cat(
+    std::declval<std::tuple<const Entity&>>(), std::declval<Args>()));
+
 public:
   class Iterator : public std::iterator<std::forward_iterator_tag, value_type>
   {
@@ -146,11 +539,10 @@ public:
     }
 
     void advance(size_t offset) {
-      _source += offset;
-
-      for (; _source != _end; ++_source) {
-        if (detail::satisfies<Ts...>(_stores, (*_source)._index)) return;
-      }
+      detail::Seek<detail::Iterator<Source>, Ts...>()( _source
+                                                     , _end
+                                                     , _stores
+                                                     , offset);
     }
 
   private:
@@ -164,8 +556,7 @@ public:
 
 public:
   EntityFilter(Source source)
-    : _source(source)
-    , _stores(store_ptrs(source))
+    : EntityFilter(source, store_ptrs(source))
   {}
 
   Iterator begin() const {
@@ -181,22 +572,485 @@ public:
   auto front() const { return *begin(); }
 
   template<typename F>
-  std::enable_if_t<IsCallable<F, detail::ComponentArg<Ts>...>>
+  std::enable_if_t<detail::IsCallableWith<F, Args>>
   each(F&& f) const {
-    for (auto entity : *this) {
-      f(detail::get_component<Ts>(entity)...);
-    }
+    if (each_grouped(f, std::false_type(), CanGroup())) return;
+
+    for_each([&](const value_type& entity) {
+      detail::call_with_components<Ts...>(f, entity);
+    });
   }
 
   template<typename F>
-  std::enable_if_t<IsCallable<F, const Entity&, detail::ComponentArg<Ts>...>>
+  std::enable_if_t<detail::IsCallableWith<F, ArgsWithEntity>>
   each(F&& f) const {
-    for (auto entity : *this) {
-      f(entity, detail::get_component<Ts>(entity)...);
+    if (each_grouped(f, std::true_type(), CanGroup())) return;
+
+    for_each([&](const value_type& entity) {
+      detail::call_with_components<Ts...>(f, entity, entity);
+    });
+  }
+
+  // Like each(), but splitting the Entities into chunks run in parallel on the
+  // pool, every Entity in exactly one chunk. Chunks cover chunk_size Entity
+  // indices (rounded up to whole 64 bit words), or rows of the tables the
+  // query is narrowed to; by default there are about eight chunks per thread.
+  // Only available for Containers. f must not create or destroy Entities or
+  // Components.
+  template<typename F>
+  void par_each(ThreadPool& pool, F&& f, size_t chunk_size = 0) const {
+    static_assert( std::is_same<std::decay_t<Source>, EntityView>::value
+                 , "par_each requires Entities of a Container");
+
+    par_each( pool, f, chunk_size
+            , std::integral_constant<bool,
+                detail::IsCallableWith<F, ArgsWithEntity>>());
+  }
+
+  // Call f(Span<const uint32_t> indices, Span<T>... components) for runs of
+  // matching Entities whose components are adjacent in memory, so that f can
+  // process whole arrays. The packed components of a Group owning exactly the
+  // queried stores are a single run, and so is the dense array of a single
+  // sparse-set stored component. When that component comes with excluded or
+  // tag ones, runs are consecutive matching positions of its dense array. When
+  // all the components are page stored, runs are consecutive Entity indices
+  // within a page; with any other mix of stores every Entity is a run of its
+  // own. Components must not be Optional; excluded and tag ones get no span
+  // (and do not affect the layout). f must not create or destroy Entities or
+  // Components.
+  template<typename F>
+  void each_chunk(F&& f) const {
+    static_assert( AllOf<(detail::IsRequired<Ts> || detail::IsExcluded<Ts>)...>
+                 , "each_chunk does not take Optional components");
+    static_assert( std::is_same<std::decay_t<Source>, EntityView>::value
+                 , "each_chunk requires Entities of a Container");
+
+    if (each_chunk_grouped(f, CanGroup())) return;
+
+    if (each_chunk_dense(f, std::integral_constant<bool,
+          detail::SpanCount<Ts...> == 1
+          && !AllOf<(detail::HasNoSpan<Ts>
+                     || !IsSparseSetStored<detail::ComponentType<Ts>>)...>>()))
+    {
+      return;
     }
+
+    each_chunk(f, std::integral_constant<bool,
+      AllOf<(detail::HasNoSpan<Ts>
+             || IsPageStored<detail::ComponentType<Ts>>)...>>());
   }
 
 private:
+  using CanGroup = std::integral_constant<bool,
+    std::is_same<std::decay_t<Source>, EntityView>::value
+    && detail::Groupable<Ts...>>;
+
+  template<typename F, typename WithEntity>
+  bool each_grouped(F&, WithEntity, std::false_type) const {
+    return false;
+  }
+
+  // When a Group owns exactly the queried stores (and the Container was
+  // narrowed to it), the components of its Entities are at the same positions
+  // in the dense arrays of all the stores. Walks backwards and skips moved
+  // positions, like EntityView, so that each Entity is visited once.
+  template<typename F, typename WithEntity>
+  bool each_grouped(F& f, WithEntity with_entity, std::true_type) const {
+    auto group = _source.group();
+    if (!group) return false;
+
+    auto& moves = std::get<0>(_stores)->moves();
+    auto  start = moves.now();
+
+    for (auto p = group->size(); p > 0; p = std::min(p - 1, group->size())) {
+      if (moves.moved_since(p - 1, start)) continue;
+      call_grouped(f, p - 1, with_entity);
+    }
+
+    return true;
+  }
+
+  template<typename F>
+  void call_grouped(F& f, size_t p, std::false_type) const {
+    f(std::get<ComponentStore<detail::ComponentType<Ts>>*>(_stores)
+        ->data()[p]...);
+  }
+
+  template<typename F>
+  void call_grouped(F& f, size_t p, std::true_type) const {
+    auto index = std::get<0>(_stores)->indices()[p];
+
+    f( get_container(_source)->get(index)
+     , std::get<ComponentStore<detail::ComponentType<Ts>>*>(_stores)
+         ->data()[p]...);
+  }
+
+  template<typename F>
+  bool each_chunk_grouped(F&, std::false_type) const {
+    return false;
+  }
+
+  template<typename F>
+  bool each_chunk_grouped(F& f, std::true_type) const {
+    auto group = _source.group();
+    if (!group) return false;
+
+    auto size = group->size();
+    if (size == 0) return true;
+
+    f( Span<const uint32_t>(std::get<0>(_stores)->indices().data(), size)
+     , Span<detail::ComponentType<Ts>>(
+         std::get<ComponentStore<detail::ComponentType<Ts>>*>(_stores)->data()
+       , size)...);
+
+    return true;
+  }
+
+  template<typename F>
+  bool each_chunk_dense(F&, std::false_type) const {
+    return false;
+  }
+
+  // Walks the dense array of the only component with a span, which is
+  // sparse-set stored, in order.
+  template<typename F>
+  bool each_chunk_dense(F& f, std::true_type) const {
+    auto& indices = *detail::Driver<Ts...>()(_stores, false).indices;
+
+    auto run = [&](size_t first, size_t count) {
+      call_chunk( f, Span<const uint32_t>(indices.data() + first, count)
+                , std::tuple_cat(dense<Ts>(first, count,
+                    std::integral_constant<bool,
+                      detail::HasNoSpan<Ts>>())...));
+    };
+
+    if (sizeof...(Ts) == 1) {
+      if (!indices.empty()) run(0, indices.size());
+      return true;
+    }
+
+    for (size_t first = 0; first < indices.size(); ) {
+      if (!detail::satisfies<Ts...>(_stores, indices[first])) {
+        ++first;
+        continue;
+      }
+
+      auto last = first + 1;
+
+      while ( last < indices.size()
+           && detail::satisfies<Ts...>(_stores, indices[last])) {
+        ++last;
+      }
+
+      run(first, last - first);
+      first = last;
+    }
+
+    return true;
+  }
+
+  // Scans the occupancy bitsets of the Container, like for_each(), regardless
+  // of how the source was narrowed: runs come out in index order. The runs of
+  // a block never cross a page.
+  template<typename F>
+  void each_chunk(F& f, std::true_type) const {
+    auto& container = *get_container(_source);
+
+    detail::Operand  required[1 + detail::RequiredCount<Ts...>];
+    detail::Operand  excluded[1 + detail::ExcludedCount<Ts...>];
+    Bitset::Word     words[detail::BLOCK_WORDS];
+    detail::IndexRun runs[detail::BLOCK_RUNS];
+    uint32_t         indices[detail::BLOCK_WORDS * Bitset::WORD_BITS];
+
+    detail::required_operands<Ts...>(container.occupancy(), _stores, required);
+    detail::excluded_operands<Ts...>(_stores, excluded);
+
+    for ( size_t first = 0
+        ; first * Bitset::WORD_BITS < container.capacity()
+        ; first += detail::BLOCK_WORDS)
+    {
+      detail::intersect( required, 1 + detail::RequiredCount<Ts...>
+                       , excluded, detail::ExcludedCount<Ts...>
+                       , first, detail::BLOCK_WORDS
+                       , words);
+
+      auto count = detail::collect_runs( words
+                                       , detail::BLOCK_WORDS
+                                       , first * Bitset::WORD_BITS
+                                       , runs);
+
+      for (size_t r = 0; r < count; ++r) {
+        auto run = runs[r];
+
+        for (uint32_t i = 0; i < run.count; ++i) {
+          indices[i] = run.first + i;
+        }
+
+        call_chunk( f, Span<const uint32_t>(indices, run.count)
+                  , std::tuple_cat(chunk<Ts>(run.first, run.count,
+                      std::integral_constant<bool,
+                        detail::HasNoSpan<Ts>>())...));
+      }
+    }
+  }
+
+  template<typename F>
+  void each_chunk(F& f, std::false_type) const {
+    for_each([&](const value_type& filtered) {
+      auto index = static_cast<uint32_t>(Entity(filtered)._index);
+
+      call_chunk( f, Span<const uint32_t>(&index, 1)
+                , std::tuple_cat(single<Ts>(filtered,
+                    std::integral_constant<bool,
+                      detail::HasNoSpan<Ts>>())...));
+    });
+  }
+
+  template<typename F, typename Args>
+  static void call_chunk(F& f, Span<const uint32_t> indices, Args&& args) {
+    auto all = std::tuple_cat(std::make_tuple(indices), std::move(args));
+
+    detail::apply( f, std::move(all)
+                 , std::make_index_sequence<
+                     std::tuple_size<decltype(all)>::value>());
+  }
+
+  // Spans of the components of type T passed to f by each_chunk(), none for
+  // excluded and tag types.
+  template<typename T>
+  std::tuple<Span<detail::ComponentType<T>>>
+  chunk(size_t first, size_t count, std::false_type) const {
+    return std::make_tuple(chunk<T>(first, count));
+  }
+
+  template<typename T>
+  std::tuple<> chunk(size_t, size_t, std::true_type) const {
+    return {};
+  }
+
+  template<typename T>
+  std::tuple<Span<detail::ComponentType<T>>>
+  dense(size_t first, size_t count, std::false_type) const {
+    using Store = ComponentStore<detail::ComponentType<T>>;
+    return std::make_tuple(Span<detail::ComponentType<T>>(
+      std::get<Store*>(_stores)->data() + first, count));
+  }
+
+  template<typename T>
+  std::tuple<> dense(size_t, size_t, std::true_type) const {
+    return {};
+  }
+
+  template<typename T>
+  std::tuple<Span<detail::ComponentType<T>>>
+  single(const value_type& filtered, std::false_type) const {
+    return std::make_tuple(Span<detail::ComponentType<T>>(
+      &detail::get_component<T>(filtered), 1));
+  }
+
+  template<typename T>
+  std::tuple<> single(const value_type&, std::true_type) const {
+    return {};
+  }
+
+  template<typename T>
+  Span<detail::ComponentType<T>> chunk(size_t first, size_t count) const {
+    using Store = ComponentStore<detail::ComponentType<T>>;
+
+    static_assert( Store::PAGE_SIZE
+                   % (detail::BLOCK_WORDS * Bitset::WORD_BITS) == 0
+                 , "blocks must not cross pages");
+
+    return { &std::get<Store*>(_stores)->get(first), count };
+  }
+
+  // Rows of a dense index table processed by one task of par_each().
+  struct Chunk {
+    const EntityView::Table* table;
+    size_t                   first;
+    size_t                   last;
+  };
+
+  static size_t chunk_count(size_t size, size_t chunk_size) {
+    return (size + chunk_size - 1) / chunk_size;
+  }
+
+  // Chunk size giving about eight chunks per thread, unless set.
+  static size_t tune(const ThreadPool& pool, size_t size, size_t chunk_size) {
+    return chunk_size ? chunk_size
+                      : std::max<size_t>(64, size / (8 * pool.size()) + 1);
+  }
+
+  template<typename F, typename WithEntity>
+  void par_each( ThreadPool& pool
+               , F&          f
+               , size_t      chunk_size
+               , WithEntity  with_entity) const
+  {
+    auto& container = *get_container(_source);
+
+    if (par_each_grouped(pool, f, chunk_size, with_entity, CanGroup())) {
+      return;
+    }
+
+    if (!_source.seekable()) {
+      Vector<Chunk> chunks(container.resource());
+      size_t rows = 0;
+
+      _source.each_table([&](const EntityView::Table& table) {
+        rows += table.size();
+      });
+
+      auto size = tune(pool, rows, chunk_size);
+
+      _source.each_table([&](const EntityView::Table& table) {
+        for (size_t first = 0; first < table.size(); first += size) {
+          auto last = std::min(table.size(), first + size);
+          chunks.push_back({ &table, first, last });
+        }
+      });
+
+      pool.run(chunks.size(), [&](size_t c) {
+        auto& chunk = chunks[c];
+
+        for (auto row = chunk.first; row < chunk.last; ++row) {
+          auto index = (*chunk.table)[row];
+
+          if (detail::satisfies<Ts...>(_stores, index)) {
+            call(f, container.get(index), with_entity);
+          }
+        }
+      });
+
+      return;
+    }
+
+    // Chunks of whole words of the bitsets, tested 64 Entities at a time.
+    auto  capacity  = container.capacity();
+    auto& occupancy = container.occupancy();
+    auto  size      = tune(pool, capacity, chunk_size);
+    auto  words     = std::max<size_t>(1, chunk_count(size, Bitset::WORD_BITS));
+
+    pool.run(chunk_count(capacity, words * Bitset::WORD_BITS), [&](size_t c) {
+      for (auto w = c * words; w < (c + 1) * words; ++w) {
+        auto bits = occupancy.word(w) & detail::mask<Ts...>(_stores, w);
+
+        for (; bits; bits &= bits - 1) {
+          auto index = w * Bitset::WORD_BITS + lowest_bit(bits);
+          call(f, container.get(index), with_entity);
+        }
+      }
+    });
+  }
+
+  template<typename F, typename WithEntity>
+  bool par_each_grouped( ThreadPool&, F&, size_t, WithEntity
+                       , std::false_type) const
+  {
+    return false;
+  }
+
+  template<typename F, typename WithEntity>
+  bool par_each_grouped( ThreadPool& pool
+                       , F&          f
+                       , size_t      chunk_size
+                       , WithEntity  with_entity
+                       , std::true_type) const
+  {
+    auto group = _source.group();
+    if (!group) return false;
+
+    auto count = group->size();
+    auto size  = tune(pool, count, chunk_size);
+
+    pool.run(chunk_count(count, size), [&](size_t c) {
+      for (auto p = c * size; p < std::min(count, (c + 1) * size); ++p) {
+        call_grouped(f, p, with_entity);
+      }
+    });
+
+    return true;
+  }
+
+  template<typename F>
+  void call(F& f, const Entity& entity, std::false_type) const {
+    detail::call_with_components<Ts...>(f, value_type(entity, _stores));
+  }
+
+  template<typename F>
+  void call(F& f, const Entity& entity, std::true_type) const {
+    detail::call_with_components<Ts...>(f, value_type(entity, _stores), entity);
+  }
+
+  template<typename G>
+  void for_each(G&& g) const {
+    for_each(g, std::is_same<std::decay_t<Source>, EntityView>());
+  }
+
+  template<typename G>
+  void for_each(G& g, std::false_type) const {
+    for (auto entity : *this) g(entity);
+  }
+
+  // When iterating all Entities of a Container, evaluate the query in blocks
+  // using the bitset kernel. A structural change done by g invalidates the rest
+  // of the block, which is then evaluated again.
+  template<typename G>
+  void for_each(G& g, std::true_type) const {
+    if (!_source.seekable()) {
+      for_each(g, std::false_type());
+      return;
+    }
+
+    auto& container = *get_container(_source);
+
+    detail::Operand     required[1 + detail::RequiredCount<Ts...>];
+    detail::Operand     excluded[1 + detail::ExcludedCount<Ts...>];
+    Bitset::Word        words[detail::BLOCK_WORDS];
+    detail::IndexRun    runs[detail::BLOCK_RUNS];
+
+    size_t next = 0;
+
+    while (next < container.capacity()) {
+      auto generation = container.generation();
+      auto first      = next / Bitset::WORD_BITS;
+
+      detail::required_operands<Ts...>(container.occupancy(), _stores, required);
+      detail::excluded_operands<Ts...>(_stores, excluded);
+      detail::intersect( required, 1 + detail::RequiredCount<Ts...>
+                       , excluded, detail::ExcludedCount<Ts...>
+                       , first, detail::BLOCK_WORDS
+                       , words);
+
+      words[0] &= ~Bitset::Word(0) << (next % Bitset::WORD_BITS);
+      next = (first + detail::BLOCK_WORDS) * Bitset::WORD_BITS;
+
+      auto count = detail::collect_runs( words
+                                       , detail::BLOCK_WORDS
+                                       , first * Bitset::WORD_BITS
+                                       , runs);
+
+      for (size_t r = 0; r < count; ++r) {
+        auto end = size_t(runs[r].first) + runs[r].count;
+
+        for (size_t index = runs[r].first; index < end; ++index) {
+          g(value_type(container.get(index), _stores));
+
+          if (container.generation() != generation) {
+            next = index + 1;
+            r    = count;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  EntityFilter(Source source, const detail::ComponentStores<Ts...>& stores)
+    : _source(detail::narrow<Ts...>(source, stores))
+    , _stores(stores)
+  {}
+
   static detail::ComponentStores<Ts...> store_ptrs(const Source& source) {
     auto container = get_container(source);
     return container
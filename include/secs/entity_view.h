@@ -1,21 +1,41 @@
 #pragma once
 
-// Sequence of all Entities in a Container.
+// Sequence of all Entities in a Container, or of the Entities listed in dense
+// index tables (the owners of a sparse-set stored component, or the archetype
+// tables matching a query).
+//
+// Iterating the tables visits each Entity at most once, even when Entities
+// are removed from them meanwhile. Entities added to the tables after the
+// iteration began are not visited. Reordering a table during the iteration
+// (sorting it, or Entities joining or leaving a Group owning its store) may
+// cause Entities to be skipped.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 #include "secs/container.h"
+#include "secs/move_stamps.h"
 
 namespace secs {
+namespace detail {
+template<typename, typename...> struct Seek;
+}
 
 class EntityView {
 public:
+  using Table  = Vector<uint32_t>;
+  using Tables = Vector<const Table*>;
+
   class Iterator : public std::iterator<std::forward_iterator_tag, Entity> {
   public:
     bool operator == (const Iterator& other) const {
-      return _index == other._index;
+      return _index == other._index && _table == other._table;
     }
 
     bool operator != (const Iterator& other) const {
-      return _index != other._index;
+      return !(*this == other);
     }
 
     Iterator& operator ++ () {
@@ -29,56 +49,249 @@ public:
     }
 
     Entity operator * () const {
-      return _container.get(_index);
+      if (_subset || _tables) {
+        return _container.get(table(_table - 1)[_index - 1]);
+      } else {
+        return _container.get(_index);
+      }
     }
 
   private:
-    Iterator(Container& container, size_t index)
-      : _container(container)
+    Iterator(const EntityView& view, size_t table, size_t index)
+      : _container(view._container)
+      , _subset(view._subset)
+      , _tables(view._tables)
+      , _moves(view._moves)
+      , _group(view._group)
+      , _table(table)
       , _index(index)
+      , _bits(0)
+      , _generation( _tables ? _container.archetype_moves()
+                   : _moves  ? _moves->now()
+                   : 0)
     {
       advance(0);
     }
 
+    const Table& table(size_t index) const {
+      return _subset ? *_subset : *(*_tables)[index];
+    }
+
+    // Number of rows of a table to visit.
+    size_t rows(size_t index) const {
+      auto size = table(index).size();
+      return _group ? std::min(size, _group->size()) : size;
+    }
+
     void advance(size_t offset) {
+      if (_subset || _tables) {
+        advance_tables(offset);
+      } else {
+        seek(offset, [](size_t) { return ~Bitset::Word(0); });
+      }
+    }
+
+    // Whether seek() can be used. Only the view of all Entities in the
+    // Container is indexed by Entity index.
+    bool seekable() const {
+      return !_subset && !_tables;
+    }
+
+    // Move by offset, then on to the first existing Entity whose bit is set in
+    // filter(w), where filter returns the 64 bit word w of a bitset indexed by
+    // Entity index. Scans a word at a time.
+    //
+    // The remaining matches in the current word are cached, and used when
+    // stepping by one, as long as the Container is not structurally modified
+    // in the meantime. The same filter must be used for every call.
+    template<typename F>
+    void seek(size_t offset, F&& filter) {
+      assert(seekable());
+
+      if (offset == 1 && _bits && _generation == _container.generation()) {
+        _index = (_index & ~(Bitset::WORD_BITS - 1)) + lowest_bit(_bits);
+        _bits &= _bits - 1;
+        return;
+      }
+
       _index += offset;
 
-      for (; _index < _container.capacity(); ++_index) {
-        if (_container.contains(_index)) return;
+      auto  capacity  = _container.capacity();
+      auto& occupancy = _container.occupancy();
+
+      while (_index < capacity) {
+        auto w    = _index / Bitset::WORD_BITS;
+        auto bits = occupancy.word(w)
+                  & filter(w)
+                  & (~Bitset::Word(0) << (_index % Bitset::WORD_BITS));
+
+        if (bits) {
+          _index      = w * Bitset::WORD_BITS + lowest_bit(bits);
+          _bits       = bits & (bits - 1);
+          _generation = _container.generation();
+          return;
+        }
+
+        _index = (w + 1) * Bitset::WORD_BITS;
+      }
+
+      _index = capacity;
+      _bits  = 0;
+    }
+
+    // The tables are walked backwards, so that removing the current Entity
+    // from its table (which moves the last one into its place) is safe.
+    // Entities moved to a position of a table after the iteration started
+    // were visited already (in that table or in their previous archetype
+    // table), or were added meanwhile, and are skipped.
+    void advance_tables(size_t offset) {
+      while (_table > 0) {
+        auto step = std::min(offset, _index);
+        _index -= step;
+        offset -= step;
+
+        _index = std::min(_index, rows(_table - 1));
+
+        if (_index > 0) {
+          if (!moved()) return;
+
+          offset = 1;
+          continue;
+        }
+
+        --_table;
+        _index = _table > 0 ? rows(_table - 1) : 0;
+      }
+    }
+
+    // Whether the current Entity moved since the iteration started.
+    bool moved() const {
+      if (_tables) {
+        auto index = table(_table - 1)[_index - 1];
+        return _container.moved_since(index, _generation);
       }
 
-      _index = _container.capacity();
+      return _moves && _moves->moved_since(_index - 1, _generation);
     }
 
   private:
-    Container& _container;
-    size_t     _index;
+    Container&        _container;
+    const Table*      _subset;
+    const Tables*     _tables;
+    const MoveStamps* _moves;
+    const GroupBase*  _group;
+    size_t            _table;
+    size_t            _index;
+    Bitset::Word      _bits;
+
+    // Generation of the Container for seek(), or time when the iteration
+    // started for tables (count of archetype moves, or of the subset stamps).
+    size_t            _generation;
 
     friend class EntityView;
+    template<typename, typename...> friend struct detail::Seek;
   };
 
   EntityView(Container& container)
     : _container(container)
+    , _subset(nullptr)
+    , _tables(nullptr)
+    , _moves(nullptr)
+    , _group(nullptr)
+  {}
+
+  // View of the Entities with the given indices. All of them must exist.
+  // Without the stamps of the positions, removing Entities other than the
+  // current one while iterating may visit Entities twice. With a Group owning
+  // the store the indices come from, only the Entities it packs at the front
+  // are visited.
+  EntityView( Container&        container
+            , const Table&      subset
+            , const MoveStamps* moves = nullptr
+            , const GroupBase*  group = nullptr)
+    : _container(container)
+    , _subset(&subset)
+    , _tables(nullptr)
+    , _moves(moves)
+    , _group(group)
+  {}
+
+  // View of the Entities in all the given tables. All of them must exist.
+  EntityView(Container& container, const Tables& tables)
+    : _container(container)
+    , _subset(nullptr)
+    , _tables(&tables)
+    , _moves(nullptr)
+    , _group(nullptr)
   {}
 
   Iterator begin() const {
-    return { _container, 0 };
+    if (_subset || _tables) {
+      return { *this, table_count(), SIZE_MAX };
+    } else {
+      return { *this, 0, 0 };
+    }
   }
 
   Iterator end() const {
-    return { _container, _container.capacity() };
+    if (_subset || _tables) {
+      return { *this, 0, 0 };
+    } else {
+      return { *this, 0, _container.capacity() };
+    }
+  }
+
+  // Whether this is the view of all Entities in the Container.
+  bool seekable() const {
+    return !_subset && !_tables;
   }
 
   bool   empty() const { return begin() == end(); }
-  size_t size()  const { return _container.size(); }
+  size_t size()  const;
+
+  // Group whose packed Entities the view is limited to, if any.
+  const GroupBase* group() const {
+    return _group;
+  }
+
+  // Call f(const Table&) for each table of a view which is not seekable. The
+  // tables are passed whole, even for views limited to a Group.
+  template<typename F>
+  void each_table(F&& f) const {
+    if (_subset) f(*_subset);
+    if (_tables) for (auto table : *_tables) f(*table);
+  }
 
   auto front() const { return *begin(); }
 
 private:
-  Container& _container;
+  size_t table_count() const {
+    return _subset ? 1 : _tables ? _tables->size() : 0;
+  }
+
+private:
+  Container&        _container;
+  const Table*      _subset;
+  const Tables*     _tables;
+  const MoveStamps* _moves;
+  const GroupBase*  _group;
+
   friend Container* get_container(const EntityView&);
 };
 
+inline size_t EntityView::size() const {
+  if (_subset) {
+    return _group ? std::min(_subset->size(), _group->size())
+                  : _subset->size();
+  }
+
+  if (!_tables) return _container.size();
+
+  size_t result = 0;
+  for (auto table : *_tables) result += table->size();
+  return result;
+}
+
 inline Container* get_container(const EntityView& range) {
   return &range._container;
 }
@@ -0,0 +1,64 @@
+#pragma once
+
+// Contiguous buffer of events of one type, waiting to be dispatched.
+
+#include <utility>
+
+#include "secs/memory_resource.h"
+#include "secs/signal.h"
+
+namespace secs {
+
+template<typename E>
+class EventQueue {
+public:
+  EventQueue() = default;
+
+  explicit EventQueue(MemoryResource& resource)
+    : _events(resource)
+    , _batch(resource)
+  {}
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator = (const EventQueue&) = delete;
+
+  template<typename... Args>
+  void push(Args&&... args) {
+    _events.emplace_back(std::forward<Args>(args)...);
+  }
+
+  bool empty() const {
+    return _events.empty();
+  }
+
+  size_t size() const {
+    return _events.size();
+  }
+
+  // Deliver the queued events to the signal (if any) and return whether there
+  // were any. Events pushed while delivering are kept for the next flush. If
+  // a handler throws, the rest of the batch is dropped.
+  bool flush(const Signal<E>* signal) {
+    if (_events.empty()) return false;
+
+    _events.swap(_batch);
+
+    try {
+      if (signal) signal->emit_batch(_batch);
+    } catch (...) {
+      _batch.clear();
+      throw;
+    }
+
+    _batch.clear();
+    return true;
+  }
+
+private:
+  Vector<E> _events;
+
+  // Events being delivered. Kept to reuse its capacity.
+  Vector<E> _batch;
+};
+
+} // namespace secs
@@ -0,0 +1,106 @@
+#pragma once
+
+// Table of component types handling events of type E, used by
+// Container::connect<E, T>(). Routes are indexed by the type indices of the
+// Container, so an event is delivered only to the types owned by its Entity,
+// found by intersecting the Entity's signature with the routed types.
+
+#include <cassert>
+#include <cstddef>
+
+#include "secs/bitset.h"
+#include "secs/memory_resource.h"
+#include "secs/signal.h"
+
+namespace secs {
+
+class Container;
+
+template<typename E>
+class EventRouter {
+public:
+  // Deliver the event to the component of the type at the Entity index.
+  using Handle = void (*)(Container&, size_t index, const E& event);
+
+  EventRouter() = default;
+
+  explicit EventRouter(MemoryResource& resource)
+    : _routes(resource)
+    , _types(resource)
+  {}
+
+  EventRouter(const EventRouter&) = delete;
+  EventRouter& operator = (const EventRouter&) = delete;
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+  // Route events to the component type. The returned Connection removes the
+  // route.
+  Connection add(size_t type, Handle handle) {
+    if (type >= _routes.size()) {
+      _routes.resize(type + 1);
+    }
+
+    auto& route = _routes[type];
+    route.handle = handle;
+    ++route.connections;
+    ++_size;
+
+    _types.set(type);
+
+    return Connection(this, type);
+  }
+
+  // Types with at least one route.
+  const Bitset& types() const {
+    return _types;
+  }
+
+  // Call the handle of the type once per connection.
+  void handle(Container& container, size_t type, size_t index, const E& event)
+  const
+  {
+    // Copied, as handlers may add routes.
+    auto route = _routes[type];
+
+    for (size_t i = 0; i < route.connections; ++i) {
+      route.handle(container, index, event);
+    }
+  }
+
+  // Connection of the router to the Signal of E, kept while there are routes.
+  ScopedConnection& slot() {
+    return _slot;
+  }
+
+private:
+  void disconnect(size_t type) {
+    assert(type < _routes.size());
+    assert(_routes[type].connections > 0);
+
+    if (--_routes[type].connections == 0) {
+      _types.reset(type);
+    }
+
+    if (--_size == 0) {
+      _slot.disconnect();
+    }
+  }
+
+private:
+  struct Route {
+    Handle handle      = nullptr;
+    size_t connections = 0;
+  };
+
+  Vector<Route>    _routes;
+  Bitset           _types;
+  size_t           _size = 0;
+  ScopedConnection _slot;
+
+  friend class Connection;
+};
+
+} // namespace secs
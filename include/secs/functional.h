@@ -1,5 +1,8 @@
 #pragma once
 
+#include <type_traits>
+#include <utility>
+
 namespace secs {
 
 struct IsCallableImpl {
@@ -16,4 +19,10 @@ struct IsCallableImpl {
 template<typename F, typename... Args>
 constexpr bool IsCallable = decltype(IsCallableImpl::test<F, Args...>(0))::value;
 
+template<bool...> struct Bools {};
+
+// Test that all of Bs are true.
+template<bool... Bs>
+constexpr bool AllOf = std::is_same<Bools<true, Bs...>, Bools<Bs..., true>>::value;
+
 } // namespace secs
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+
+#include "secs/component_store.h"
+#include "secs/functional.h"
+#include "secs/storage_policy.h"
+
+namespace secs {
+
+// State of a Group shared by the ComponentStores it owns, through which they
+// notify it of added and removed components.
+class GroupBase {
+public:
+  virtual ~GroupBase() = default;
+
+  // Number of Entities owning all the component types of the group.
+  size_t size() const {
+    return _size;
+  }
+
+  // Number of component types of the group.
+  size_t arity() const {
+    return _arity;
+  }
+
+  // Component was added to the Entity with the given index.
+  virtual void added(size_t index) = 0;
+
+  // Component of the Entity with the given index is about to be removed.
+  virtual void removed(size_t index) = 0;
+
+protected:
+  explicit GroupBase(size_t arity)
+    : _arity(arity)
+  {}
+
+  size_t _size = 0;
+
+private:
+  size_t _arity;
+};
+
+// Group owning the ComponentStores of types Ts..., which must all use
+// SparseSetStorage. The Entities owning all of Ts... are kept packed at the
+// front of each store, in the same order, so a query for exactly Ts... is a
+// linear walk over the dense arrays. A store can be owned by one group only,
+// and owned stores cannot be sorted.
+template<typename... Ts>
+class Group : public GroupBase {
+  static_assert( AllOf<IsSparseSetStored<Ts>...>
+               , "Group requires SparseSetStorage");
+
+public:
+  Group()
+    : GroupBase(sizeof...(Ts))
+  {}
+
+  ~Group() {
+    if (!*this) return;
+
+    int expand[] = { 0, (store<Ts>().set_group(nullptr), 0)... };
+    (void) expand;
+  }
+
+  Group(const Group&) = delete;
+  Group& operator = (const Group&) = delete;
+
+  explicit operator bool () const {
+    return std::get<0>(_stores) != nullptr;
+  }
+
+  // Take ownership of the stores, and pack the Entities already owning all the
+  // components.
+  void own(ComponentStore<Ts>&... stores) {
+    assert(!*this);
+
+    _stores = std::make_tuple(&stores...);
+
+    int expand[] = { 0, (assert(!stores.group()), stores.set_group(this), 0)... };
+    (void) expand;
+
+    auto& first = std::get<0>(_stores)->indices();
+
+    for (size_t i = 0; i < first.size(); ++i) {
+      added(first[i]);
+    }
+  }
+
+  void added(size_t index) override {
+    if (!owns_all(index) || packed(index)) return;
+
+    int expand[] = { 0, (store<Ts>().swap_positions(
+      store<Ts>().position(index), static_cast<uint32_t>(_size)), 0)... };
+    (void) expand;
+
+    ++_size;
+  }
+
+  void removed(size_t index) override {
+    if (!owns_all(index) || !packed(index)) return;
+
+    --_size;
+
+    int expand[] = { 0, (store<Ts>().swap_positions(
+      store<Ts>().position(index), static_cast<uint32_t>(_size)), 0)... };
+    (void) expand;
+  }
+
+private:
+  template<typename T>
+  ComponentStore<T>& store() const {
+    return *std::get<ComponentStore<T>*>(_stores);
+  }
+
+  bool owns_all(size_t index) const {
+    bool result = true;
+
+    int expand[] = { 0, (result = result && store<Ts>().contains(index), 0)... };
+    (void) expand;
+
+    return result;
+  }
+
+  bool packed(size_t index) const {
+    return std::get<0>(_stores)->position(index) < _size;
+  }
+
+private:
+  std::tuple<ComponentStore<Ts>*...> _stores;
+};
+
+namespace detail {
+
+template<typename S>
+void group_added(S&, size_t) {}
+
+template<typename S>
+void group_removed(S&, size_t) {}
+
+template<typename T>
+void group_added(ComponentStore<T, SparseSetStorage>& store, size_t index) {
+  if (auto group = store.group()) group->added(index);
+}
+
+template<typename T>
+void group_removed(ComponentStore<T, SparseSetStorage>& store, size_t index) {
+  if (auto group = store.group()) group->removed(index);
+}
+
+} // namespace detail
+} // namespace secs
@@ -0,0 +1,61 @@
+#pragma once
+
+// Storage policy of the type-erased holders (BasicAny, Delegate).
+//
+// Values which fit into the inline buffer of Size bytes (and are nothrow move
+// constructible) are stored inside the holder, and relocated when it is moved.
+// Bigger values are allocated from a MemoryResource, and the holder keeps
+// their pointer and resource in the buffer.
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "secs/memory_resource.h"
+
+namespace secs {
+namespace detail {
+
+template<size_t Size>
+using InlineBuffer = typename std::aligned_storage<Size, alignof(void*)>::type;
+
+// Whether values of type T are stored in an inline buffer of Size bytes.
+template<typename T, size_t Size>
+constexpr bool stores_inline() {
+  using U = std::decay_t<T>;
+
+  return sizeof(U)  <= Size
+      && alignof(U) <= alignof(InlineBuffer<Size>)
+      && std::is_nothrow_move_constructible<U>::value;
+}
+
+// Record kept in the buffer of a holder for a value allocated from a resource.
+// Moving the holder copies the record.
+struct HeapValue {
+  void*           object;
+  MemoryResource* resource;
+
+  // Allocate a T from the resource, and place its record into the buffer.
+  template<typename T, typename... Args>
+  static void construct(void* buffer, MemoryResource& resource, Args&&... args)
+  {
+    new (buffer) HeapValue{ make<T>(resource, std::forward<Args>(args)...)
+                          , &resource };
+  }
+
+  // Destroy the T whose record is in the buffer.
+  template<typename T>
+  static void destroy(void* buffer) {
+    auto& heap = *static_cast<HeapValue*>(buffer);
+    unmake(*heap.resource, static_cast<T*>(heap.object));
+  }
+
+  template<typename T>
+  static T& get(void* buffer) {
+    return *static_cast<T*>(static_cast<HeapValue*>(buffer)->object);
+  }
+};
+
+} // namespace detail
+} // namespace secs
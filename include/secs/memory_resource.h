@@ -0,0 +1,220 @@
+#pragma once
+
+// Polymorphic memory resources, modelled after std::pmr (which is not
+// available in C++14).
+//
+// A Container allocates all its storage (ComponentStores, Entity versions,
+// Signals...) from a MemoryResource, so a whole world can be placed into an
+// arena, a pool or any other custom memory.
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace secs {
+
+class MemoryResource {
+public:
+  virtual ~MemoryResource() = default;
+
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    return do_allocate(bytes, alignment);
+  }
+
+  void deallocate( void*  p
+                 , size_t bytes
+                 , size_t alignment = alignof(std::max_align_t))
+  {
+    do_deallocate(p, bytes, alignment);
+  }
+
+  bool is_equal(const MemoryResource& other) const noexcept {
+    return do_is_equal(other);
+  }
+
+private:
+  virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+  virtual void  do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+  virtual bool  do_is_equal(const MemoryResource& other) const noexcept {
+    return this == &other;
+  }
+};
+
+inline bool operator == (const MemoryResource& a, const MemoryResource& b) {
+  return &a == &b || a.is_equal(b);
+}
+
+inline bool operator != (const MemoryResource& a, const MemoryResource& b) {
+  return !(a == b);
+}
+
+// Resource using the global operator new and delete.
+MemoryResource* new_delete_resource() noexcept;
+
+// Allocator adapting MemoryResource for the standard containers.
+template<typename T>
+class Allocator {
+public:
+  using value_type = T;
+
+  Allocator() noexcept
+    : _resource(new_delete_resource())
+  {}
+
+  Allocator(MemoryResource& resource) noexcept
+    : _resource(&resource)
+  {}
+
+  template<typename U>
+  Allocator(const Allocator<U>& other) noexcept
+    : _resource(other.resource())
+  {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(_resource->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    _resource->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  // Copies of containers use the default resource, like std::pmr.
+  Allocator select_on_container_copy_construction() const {
+    return {};
+  }
+
+  MemoryResource* resource() const noexcept {
+    return _resource;
+  }
+
+private:
+  MemoryResource* _resource;
+};
+
+template<typename T, typename U>
+bool operator == (const Allocator<T>& a, const Allocator<U>& b) {
+  return *a.resource() == *b.resource();
+}
+
+template<typename T, typename U>
+bool operator != (const Allocator<T>& a, const Allocator<U>& b) {
+  return !(a == b);
+}
+
+template<typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+// Construct an object of type T in memory allocated from the resource.
+template<typename T, typename... Args>
+T* make(MemoryResource& resource, Args&&... args) {
+  auto p = resource.allocate(sizeof(T), alignof(T));
+
+  try {
+    return new (p) T(std::forward<Args>(args)...);
+  } catch (...) {
+    resource.deallocate(p, sizeof(T), alignof(T));
+    throw;
+  }
+}
+
+// Destroy an object created by make() and return its memory to the resource.
+template<typename T>
+void unmake(MemoryResource& resource, T* object) {
+  if (!object) return;
+
+  object->~T();
+  resource.deallocate(object, sizeof(T), alignof(T));
+}
+
+template<typename T>
+struct Deleter {
+  MemoryResource* resource;
+
+  void operator () (T* object) const {
+    unmake(*resource, object);
+  }
+};
+
+// Owning pointer to an object created by make().
+template<typename T>
+using UniquePtr = std::unique_ptr<T, Deleter<T>>;
+
+template<typename T, typename... Args>
+UniquePtr<T> allocate_unique(MemoryResource& resource, Args&&... args) {
+  return { make<T>(resource, std::forward<Args>(args)...), { &resource } };
+}
+
+// Resource which hands out memory by bumping a pointer through chunks
+// obtained from the upstream resource. Deallocation is a no-op, the memory is
+// released all at once by release() or on destruction.
+class MonotonicResource : public MemoryResource {
+public:
+  explicit MonotonicResource( size_t          initial_size = 4096
+                            , MemoryResource& upstream = *new_delete_resource());
+
+  ~MonotonicResource();
+
+  MonotonicResource(const MonotonicResource&) = delete;
+  MonotonicResource& operator = (const MonotonicResource&) = delete;
+
+  void release();
+
+  MemoryResource& upstream() const {
+    return _upstream;
+  }
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void  do_deallocate(void*, size_t, size_t) override {}
+
+private:
+  struct Chunk {
+    Chunk* next;
+    size_t size;
+  };
+
+  MemoryResource& _upstream;
+  Chunk*          _chunks = nullptr;
+  char*           _current = nullptr;
+  size_t          _left = 0;
+  size_t          _next_size;
+};
+
+// Resource which keeps freed blocks in free lists per power-of-two size class,
+// and reuses them for subsequent allocations. Blocks larger than LARGEST_BLOCK
+// are passed through to the upstream resource: they are neither pooled nor
+// released by release(), and must be deallocated individually.
+class PoolResource : public MemoryResource {
+public:
+  static constexpr size_t LARGEST_BLOCK = 4096;
+
+  explicit PoolResource(MemoryResource& upstream = *new_delete_resource());
+  ~PoolResource();
+
+  PoolResource(const PoolResource&) = delete;
+  PoolResource& operator = (const PoolResource&) = delete;
+
+  void release();
+
+  MemoryResource& upstream() const {
+    return _upstream;
+  }
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void  do_deallocate(void* p, size_t bytes, size_t alignment) override;
+
+  static size_t size_class(size_t bytes, size_t alignment);
+
+private:
+  struct Block { Block* next; };
+
+  static constexpr size_t CLASS_COUNT = 10; // 8 .. 4096 bytes
+
+  MemoryResource& _upstream;
+  Block*          _free[CLASS_COUNT] = {};
+  MonotonicResource _chunks;
+};
+
+} // namespace secs
@@ -0,0 +1,53 @@
+#pragma once
+
+// Stamps of the positions of a dense table of Entity indices (the owners of a
+// sparse-set stored component, or the matches of a Query), telling which
+// positions received an Entity moved from another position after a point in
+// time.
+//
+// The tables are walked backwards, and removing an Entity moves the last one
+// into its place. The last one was visited already (or added after the walk
+// began), so walks skip the positions stamped after they began, to visit each
+// Entity at most once.
+
+#include <cstddef>
+
+#include "secs/memory_resource.h"
+
+namespace secs {
+
+class MoveStamps {
+public:
+  MoveStamps() = default;
+
+  explicit MoveStamps(MemoryResource& resource)
+    : _stamps(resource)
+  {}
+
+  // Time of the latest stamp.
+  size_t now() const {
+    return _clock;
+  }
+
+  bool moved_since(size_t position, size_t time) const {
+    return position < _stamps.size() && _stamps[position] > time;
+  }
+
+  // An Entity was moved to the position.
+  void stamp(size_t position) {
+    if (position >= _stamps.size()) _stamps.resize(position + 1, 0);
+    _stamps[position] = ++_clock;
+  }
+
+  // Forget the positions from size up.
+  void truncate(size_t size) {
+    if (size < _stamps.size()) _stamps.resize(size);
+    _stamps.shrink_to_fit();
+  }
+
+private:
+  Vector<size_t> _stamps;
+  size_t         _clock = 0;
+};
+
+} // namespace secs
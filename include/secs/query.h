@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "secs/entity_filter.h"
+#include "secs/memory_resource.h"
+#include "secs/move_stamps.h"
+
+namespace secs {
+
+// State of a Query shared with the Container, through which it notifies the
+// query of structural changes of the Entities.
+class QueryBase {
+public:
+  virtual ~QueryBase() = default;
+
+  QueryBase(const QueryBase&) = delete;
+  QueryBase& operator = (const QueryBase&) = delete;
+
+  // Number of matching Entities.
+  size_t size() const {
+    return _indices.size();
+  }
+
+  bool empty() const {
+    return _indices.empty();
+  }
+
+  // Indices of the matching Entities, in no particular order.
+  const Vector<uint32_t>& indices() const {
+    return _indices;
+  }
+
+  bool contains(size_t index) const {
+    return index < _positions.size() && _positions[index] != NONE;
+  }
+
+  // Stamps of the positions in indices() which received an index moved from
+  // another position.
+  const MoveStamps& moves() const {
+    return _moves;
+  }
+
+  // Component of one of the queried types was added to or removed from the
+  // Entity with the given index.
+  virtual void update(size_t index) = 0;
+
+  // Entity was moved from index from to the free index to.
+  void relocate(size_t from, size_t to);
+
+protected:
+  explicit QueryBase(MemoryResource& resource)
+    : _indices(resource)
+    , _positions(resource)
+    , _moves(resource)
+  {}
+
+  void insert(size_t index) {
+    if (contains(index)) return;
+
+    reserve(index);
+    _positions[index] = static_cast<uint32_t>(_indices.size());
+    _indices.push_back(static_cast<uint32_t>(index));
+  }
+
+  // Swap the last index into the place of the erased one.
+  void erase(size_t index) {
+    if (!contains(index)) return;
+
+    auto position = _positions[index];
+    auto last     = _indices.back();
+
+    if (position + 1 < _indices.size()) _moves.stamp(position);
+
+    _indices[position] = last;
+    _positions[last]   = position;
+    _indices.pop_back();
+    _positions[index]  = NONE;
+  }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  void reserve(size_t index) {
+    if (index >= _positions.size()) _positions.resize(index + 1, NONE);
+  }
+
+private:
+  Vector<uint32_t> _indices;
+
+  // Position in _indices per Entity index, or NONE.
+  Vector<uint32_t> _positions;
+  MoveStamps       _moves;
+};
+
+namespace detail {
+
+// Tuple of the arguments passed to Query::each() for the component of the
+// matching Entity with the given index.
+template<typename C> struct GetStoreArgs {
+  template<typename S>
+  std::tuple<ComponentArg<C>> operator () (const S& stores, size_t index) const
+  {
+    using Store = ComponentStore<ComponentType<C>>;
+    return std::tuple<ComponentArg<C>>(std::get<Store*>(stores)->get(index));
+  }
+};
+
+template<typename C> struct GetStoreArgs<Optional<C>> {
+  template<typename S>
+  std::tuple<C*> operator () (const S& stores, size_t index) const {
+    auto store = std::get<ComponentStore<C>*>(stores);
+    return std::tuple<C*>(
+      store->contains(index) ? &store->get(index) : nullptr);
+  }
+};
+
+template<typename C> struct GetStoreArgs<Without<C>> {
+  template<typename S>
+  std::tuple<> operator () (const S&, size_t) const {
+    return {};
+  }
+};
+
+} // namespace detail
+
+// Persistent query for the Entities satisfying the filter Ts... (with the same
+// meaning as in Container::entities()), created by Container::query(). The
+// matching Entities are kept in a packed array, updated by the Container when
+// components of the queried types are created or destroyed, so iterating
+// involves no filtering.
+template<typename... Ts>
+class Query : public QueryBase {
+  static_assert( detail::RequiredCount<Ts...> > 0
+               , "Query requires a component");
+
+  // Arguments of the function passed to each(), without and with the Entity.
+  using Args           = detail::ComponentArgs<Ts...>;
+  using ArgsWithEntity = decltype(std::tuple_cat(
+    std::declval<std::tuple<const Entity&>>(), std::declval<Args>()));
+
+public:
+  explicit Query(MemoryResource& resource)
+    : QueryBase(resource)
+    , _container(nullptr)
+  {}
+
+  explicit operator bool () const {
+    return _container != nullptr;
+  }
+
+  // The matching Entities.
+  EntityView entities() const {
+    assert(*this);
+    return { *_container, indices(), &moves() };
+  }
+
+  // Call f with the components of each matching Entity, like
+  // EntityFilter::each(). Walks backwards and skips moved positions, like
+  // EntityView, so that each Entity is visited at most once while Entities
+  // leave the query; Entities joining it meanwhile are not visited.
+  template<typename F>
+  std::enable_if_t<detail::IsCallableWith<F, Args>>
+  each(F&& f) const {
+    auto start = moves().now();
+
+    for (auto p = size(); p > 0; p = std::min(p - 1, size())) {
+      if (moves().moved_since(p - 1, start)) continue;
+      call(f, indices()[p - 1]);
+    }
+  }
+
+  template<typename F>
+  std::enable_if_t<detail::IsCallableWith<F, ArgsWithEntity>>
+  each(F&& f) const {
+    auto start = moves().now();
+
+    for (auto p = size(); p > 0; p = std::min(p - 1, size())) {
+      if (moves().moved_since(p - 1, start)) continue;
+
+      auto index = indices()[p - 1];
+      call(f, index, _container->get(index));
+    }
+  }
+
+  void update(size_t index) override {
+    if (detail::satisfies<Ts...>(_stores, index)) {
+      insert(index);
+    } else {
+      erase(index);
+    }
+  }
+
+private:
+  void bind(Container& container, const detail::ComponentStores<Ts...>& stores)
+  {
+    assert(!*this);
+
+    _container = &container;
+    _stores    = stores;
+  }
+
+  template<typename F, typename... Prefix>
+  void call(F& f, size_t index, Prefix&&... prefix) const {
+    auto args = std::tuple_cat( std::forward_as_tuple(prefix...)
+                              , detail::GetStoreArgs<Ts>()(_stores, index)...);
+
+    detail::apply( f, std::move(args)
+                 , std::make_index_sequence<
+                     std::tuple_size<decltype(args)>::value>());
+  }
+
+private:
+  Container*                     _container;
+  detail::ComponentStores<Ts...> _stores;
+
+  friend class Container;
+};
+
+} // namespace secs
@@ -0,0 +1,97 @@
+#pragma once
+
+// Kernel evaluating queries over occupancy bitsets in bulk.
+//
+// The kernel ANDs the required bitsets and subtracts the excluded ones over a
+// range of words, using SSE2 or AVX2 when available (selected at runtime) with
+// a scalar fallback, and then converts the result into runs of consecutive
+// matching indices.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "secs/bitset.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SECS_X86 1
+#endif
+
+namespace secs {
+namespace detail {
+
+// Words of a bitset. Words past size are zero.
+struct Operand {
+  const Bitset::Word* words;
+  size_t              size;
+};
+
+inline Operand operand(const Bitset& bitset) {
+  return { bitset.data(), bitset.word_count() };
+}
+
+// Run of consecutive indices.
+struct IndexRun {
+  uint32_t first;
+  uint32_t count;
+};
+
+// Number of words evaluated per block, and the most runs a block can produce.
+constexpr size_t BLOCK_WORDS = 8;
+constexpr size_t BLOCK_RUNS  = BLOCK_WORDS * Bitset::WORD_BITS / 2;
+
+// Compute words [first, first + count) of the AND of the required operands
+// minus the OR of the excluded ones into out. There must be at least one
+// required operand.
+void intersect( const Operand* required
+              , size_t         required_count
+              , const Operand* excluded
+              , size_t         excluded_count
+              , size_t         first
+              , size_t         count
+              , Bitset::Word*  out);
+
+// The implementations intersect() selects from, exposed for testing. The SSE2
+// and AVX2 ones exist on x86 only, and the AVX2 one may only be called when
+// avx2_supported().
+void intersect_scalar( const Operand* required
+                     , size_t         required_count
+                     , const Operand* excluded
+                     , size_t         excluded_count
+                     , size_t         first
+                     , size_t         count
+                     , Bitset::Word*  out);
+
+#ifdef SECS_X86
+void intersect_sse2( const Operand* required
+                   , size_t         required_count
+                   , const Operand* excluded
+                   , size_t         excluded_count
+                   , size_t         first
+                   , size_t         count
+                   , Bitset::Word*  out);
+
+void intersect_avx2( const Operand* required
+                   , size_t         required_count
+                   , const Operand* excluded
+                   , size_t         excluded_count
+                   , size_t         first
+                   , size_t         count
+                   , Bitset::Word*  out);
+
+bool avx2_supported();
+#endif
+
+// Collect the runs of set bits in count words into out, which must have room
+// for count * WORD_BITS / 2 runs. Bit i of words[0] stands for index base + i.
+// Returns the number of runs.
+size_t collect_runs( const Bitset::Word* words
+                   , size_t              count
+                   , size_t              base
+                   , IndexRun*           out);
+
+// Name of the instruction set the kernel runs with ("avx2", "sse2" or
+// "scalar").
+const char* kernel_name();
+
+} // namespace detail
+} // namespace secs
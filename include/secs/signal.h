@@ -3,14 +3,19 @@
 // Minimalistic implementation of the Signal-Slot mechanism.
 
 #include <cassert>
-#include <functional>
+#include <cstddef>
+#include <type_traits>
 #include <vector>
 
+#include "secs/delegate.h"
 #include "secs/functional.h"
+#include "secs/memory_resource.h"
+#include "secs/span.h"
 
 namespace secs {
 
 class ScopedConnection;
+template<typename> class EventRouter;
 template<typename> class Signal;
 
 class Connection {
@@ -35,17 +40,18 @@ public:
 private:
   using DisconnectFun = void (*)(void*, size_t);
 
-  template<typename T>
+  template<typename S>
   static void disconnect(void* signal, size_t index) {
-    reinterpret_cast<Signal<T>*>(signal)->disconnect(index);
+    reinterpret_cast<S*>(signal)->disconnect(index);
   }
 
 private:
-  template<typename T>
-  Connection(Signal<T>* signal, size_t index)
+  // Connection to the slot at index of a Signal or an EventRouter.
+  template<typename S>
+  Connection(S* signal, size_t index)
     : _signal(signal)
     , _index(index)
-    , _disconnect(&disconnect<T>)
+    , _disconnect(&disconnect<S>)
   {}
 
   void*         _signal = nullptr;
@@ -53,6 +59,7 @@ private:
   DisconnectFun _disconnect = nullptr;
 
   template<typename> friend class Signal;
+  template<typename> friend class EventRouter;
 };
 
 template<typename T>
@@ -61,6 +68,12 @@ class Signal {
 
 public:
   Signal() = default;
+
+  explicit Signal(MemoryResource& resource)
+    : _slots(resource)
+    , _holes(resource)
+  {}
+
   Signal(const Signal&) = delete;
   Signal(Signal&&) = delete;
 
@@ -71,21 +84,46 @@ public:
   Signal& operator = (const Signal&) = delete;
   Signal& operator = (Signal&&) = delete;
 
+  // Connect a handler called with each event.
   template<typename F>
   Connection connect(F&& fun);
 
+  // Connect a handler called once with all the events of a batch, as
+  // Span<const T>.
+  template<typename F>
+  Connection connect_batch(F&& fun);
+
+  // Test that no slot is connected.
+  bool empty() const {
+    return _slots.size() == _holes.size();
+  }
+
   void disconnect_all() {
     _slots.clear();
     _holes.clear();
   }
 
   void operator () (const T& event) const {
+    emit_batch({ &event, 1 });
+  }
+
+  // Emit the events slot by slot, so that each handler sees all of them in
+  // one call.
+  void emit_batch(Span<const T> events) const {
+    if (events.empty()) return;
+
     for (auto& slot : _slots) {
-      if (slot) slot(event);
+      if (slot) slot(events);
     }
   }
 
 private:
+  // Resource of the Signal, from which handlers too large to be stored inline
+  // are allocated as well.
+  MemoryResource& resource() const {
+    return *_slots.get_allocator().resource();
+  }
+
   size_t reserve() {
     if (_holes.empty()) {
       _slots.resize(_slots.size() + 1);
@@ -106,8 +144,9 @@ private:
   }
 
 private:
-  std::vector<std::function<void(const T&)>> _slots;
-  std::vector<size_t>                        _holes;
+  // Every slot takes a batch. Handlers of single events loop over it.
+  Vector<Delegate<void(Span<const T>)>> _slots;
+  Vector<size_t>                        _holes;
 
   friend class Connection;
 };
@@ -154,15 +193,36 @@ inline ScopedConnection Connection::scoped() && {
   return { std::move(*this) };
 }
 
+namespace detail {
+
+// Adapts handlers of single events to the slot signature, resolving invoke()
+// at compile time so that emitting a batch is one indirect call per slot.
+template<typename F, typename T>
+struct Slot {
+  F fun;
+
+  void operator () (Span<const T> events) {
+    using secs::invoke;
+    for (auto& event : events) invoke(fun, event);
+  }
+};
+
+} // namespace detail
+
 } // namespace secs
 
 template<typename T> template<typename F>
 secs::Connection secs::Signal<T>::connect(F&& fun) {
-  using secs::invoke;
+  using Slot = detail::Slot<std::decay_t<F>, T>;
+
+  auto index = reserve();
+  _slots[index].assign_in(resource(), Slot{ std::forward<F>(fun) });
+  return Connection(this, index);
+}
 
+template<typename T> template<typename F>
+secs::Connection secs::Signal<T>::connect_batch(F&& fun) {
   auto index = reserve();
-  _slots[index] = [fun = std::forward<F>(fun)](const T& event) {
-    invoke(fun, event);
-  };
+  _slots[index].assign_in(resource(), std::forward<F>(fun));
   return Connection(this, index);
 }
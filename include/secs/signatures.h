@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+
+#include "secs/bitset.h"
+#include "secs/memory_resource.h"
+
+namespace secs {
+
+// Bitmask per Entity index of the component types owned by the Entity,
+// identified by the Container's type indices. The masks are stored in rows of
+// equal number of words, which grows with the number of types.
+class Signatures {
+public:
+  Signatures() = default;
+
+  explicit Signatures(MemoryResource& resource)
+    : _words(resource)
+  {}
+
+  bool test(size_t entity, size_t type) const {
+    return word(entity, type / Bitset::WORD_BITS) & mask(type);
+  }
+
+  void set(size_t entity, size_t type);
+
+  void reset(size_t entity, size_t type) {
+    if (type / Bitset::WORD_BITS >= _stride) return;
+    if (entity >= rows()) return;
+
+    _words[entity * _stride + type / Bitset::WORD_BITS] &= ~mask(type);
+  }
+
+  // Reset all types of the entity.
+  void clear(size_t entity);
+
+  // Move the signature of entity from to the cleared entity to.
+  void move(size_t from, size_t to);
+
+  // Forget entities from size up.
+  void truncate(size_t size);
+
+  // Call f(type) for each type set for the entity. f can modify the signatures.
+  template<typename F>
+  void each(size_t entity, F&& f) const {
+    for (size_t w = 0; w < _stride; ++w) {
+      for (auto bits = word(entity, w); bits; bits &= bits - 1) {
+        f(w * Bitset::WORD_BITS + lowest_bit(bits));
+      }
+    }
+  }
+
+  // Call f(type) for each type set for the entity and in types.
+  template<typename F>
+  void each(size_t entity, const Bitset& types, F&& f) const {
+    for (size_t w = 0; w < _stride && w < types.word_count(); ++w) {
+      auto bits = word(entity, w) & types.word(w);
+
+      for (; bits; bits &= bits - 1) {
+        f(w * Bitset::WORD_BITS + lowest_bit(bits));
+      }
+    }
+  }
+
+private:
+  static Bitset::Word mask(size_t type) {
+    return Bitset::Word(1) << (type % Bitset::WORD_BITS);
+  }
+
+  size_t rows() const {
+    return _words.size() / _stride;
+  }
+
+  Bitset::Word word(size_t entity, size_t w) const {
+    return entity < rows() && w < _stride ? _words[entity * _stride + w] : 0;
+  }
+
+  void restride(size_t stride);
+
+private:
+  size_t               _stride = 1;
+  Vector<Bitset::Word> _words;
+};
+
+} // namespace secs
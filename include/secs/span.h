@@ -0,0 +1,56 @@
+#pragma once
+
+// Non-owning view of a contiguous sequence of values.
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+namespace secs {
+
+template<typename T>
+class Span {
+public:
+  using value_type = std::remove_cv_t<T>;
+  using iterator   = T*;
+
+  Span() = default;
+
+  Span(T* data, size_t size)
+    : _data(data)
+    , _size(size)
+  {}
+
+  // Views the elements of any contiguous container (vectors, arrays).
+  template< typename C
+          , typename = std::enable_if_t<std::is_convertible<
+              decltype(std::declval<C&>().data()), T*>::value>>
+  Span(C& container)
+    : Span(container.data(), container.size())
+  {}
+
+  // Span<T> converts to Span<const T>.
+  template< typename U
+          , typename = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+  Span(const Span<U>& other)
+    : Span(other.data(), other.size())
+  {}
+
+  T* data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  T* begin() const { return _data; }
+  T* end()   const { return _data + _size; }
+
+  T& operator [] (size_t index) const {
+    assert(index < _size);
+    return _data[index];
+  }
+
+private:
+  T*     _data = nullptr;
+  size_t _size = 0;
+};
+
+} // namespace secs
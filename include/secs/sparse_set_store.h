@@ -0,0 +1,369 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "secs/bitset.h"
+#include "secs/component_store.h"
+#include "secs/memory_resource.h"
+#include "secs/move_stamps.h"
+#include "secs/storage_policy.h"
+#include "secs/version.h"
+
+namespace secs {
+
+class GroupBase;
+template<typename...> class Group;
+
+// Storage for all Components of type T in a Container, packed in a dense array.
+//
+// A paged sparse index maps Entity indices to positions in the dense arrays.
+// Erasing moves the last component into the erased position, so unlike with
+// PagedStorage, references to components are invalidated by erase, by growth
+// and by sorting. The Entity indices of the owners are available in dense order via
+// indices(). All memory is allocated from the given MemoryResource.
+template<typename T>
+class ComponentStore<T, SparseSetStorage> {
+  static_assert( std::is_move_constructible<T>::value
+              && std::is_move_assignable<T>::value
+               , "SparseSetStorage requires movable component type");
+
+public:
+  static constexpr size_t PAGE_SHIFT = 10;
+  static constexpr size_t PAGE_SIZE  = size_t(1) << PAGE_SHIFT;
+
+  ComponentStore()
+    : ComponentStore(*new_delete_resource())
+  {}
+
+  explicit ComponentStore(MemoryResource& resource)
+    : _resource(&resource)
+    , _sparse(resource)
+    , _indices(resource)
+    , _versions(resource)
+    , _data(resource)
+    , _occupancy(resource)
+    , _moves(resource)
+  {}
+
+  ComponentStore(const ComponentStore&) = delete;
+  ComponentStore(ComponentStore&&) = default;
+
+  ComponentStore& operator = (const ComponentStore&) = delete;
+  ComponentStore& operator = (ComponentStore&&) = default;
+
+  size_t size() const {
+    return _sparse.size() << PAGE_SHIFT;
+  }
+
+  // Number of components in this store.
+  size_t count() const {
+    return _indices.size();
+  }
+
+  // Indices of the Entities owning a component, in dense order.
+  const Vector<uint32_t>& indices() const {
+    return _indices;
+  }
+
+  // Stamps of the positions in indices() which received a component moved
+  // from another position.
+  const MoveStamps& moves() const {
+    return _moves;
+  }
+
+  // Components in dense order, parallel to indices().
+  T* data() {
+    return _data.data();
+  }
+
+  const T* data() const {
+    return _data.data();
+  }
+
+  // Group owning this store, if any.
+  GroupBase* group() const {
+    return _group;
+  }
+
+  void set_group(GroupBase* group) {
+    _group = group;
+  }
+
+  bool contains(size_t index, Version version) const {
+    auto pos = position(index);
+    return pos != NONE && _versions[pos] == version;
+  }
+
+  bool contains(size_t index) const {
+    return _occupancy.test(index);
+  }
+
+  // Bit per Entity index, set if the store contains a component for it.
+  const Bitset& occupancy() const {
+    return _occupancy;
+  }
+
+  T& get(size_t index) {
+    assert(contains(index));
+    return _data[position(index)];
+  }
+
+  const T& get(size_t index) const {
+    assert(contains(index));
+    return _data[position(index)];
+  }
+
+  template<typename... Args>
+  void emplace(size_t index, Version version, Args&&... args);
+
+  void erase(size_t index);
+
+  // Move the component of Entity index from to the free index to. The
+  // component itself stays in place.
+  void relocate(size_t from, size_t to, Version version);
+
+  // Free sparse pages which map no components and release unused capacity.
+  void shrink_to_fit();
+
+  // Sort the components so that iterating them backwards in dense order (as
+  // EntityView does) visits them in the order given by compare.
+  template<typename Compare>
+  void sort(Compare compare);
+
+  // Rearrange the components so that those whose owners also own a component
+  // in leader come last, in the same dense order as in leader.
+  template<typename S>
+  void follow(const S& leader);
+
+  // Whether sort() was called. Adding or removing components disturbs the
+  // order, but the store is still the preferred one to drive queries with.
+  bool sorted() const {
+    return _sorted;
+  }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Page {
+    Page() {
+      std::fill_n(positions, PAGE_SIZE, NONE);
+    }
+
+    uint32_t positions[PAGE_SIZE];
+  };
+
+  static size_t offset(size_t index) {
+    return index & (PAGE_SIZE - 1);
+  }
+
+  uint32_t position(size_t index) const {
+    auto page = index >> PAGE_SHIFT;
+
+    if (page < _sparse.size() && _sparse[page]) {
+      return _sparse[page]->positions[offset(index)];
+    } else {
+      return NONE;
+    }
+  }
+
+  uint32_t& sparse(size_t index) {
+    assert(_sparse[index >> PAGE_SHIFT]);
+    return _sparse[index >> PAGE_SHIFT]->positions[offset(index)];
+  }
+
+  uint32_t& reserve_for(size_t index) {
+    auto page = index >> PAGE_SHIFT;
+
+    if (page >= _sparse.size()) {
+      _sparse.resize(page + 1);
+    }
+
+    if (!_sparse[page]) {
+      _sparse[page] = allocate_unique<Page>(*_resource);
+    }
+
+    return _sparse[page]->positions[offset(index)];
+  }
+
+  void swap_positions(uint32_t a, uint32_t b) {
+    using std::swap;
+
+    swap(_data[a],     _data[b]);
+    swap(_indices[a],  _indices[b]);
+    swap(_versions[a], _versions[b]);
+
+    sparse(_indices[a]) = a;
+    sparse(_indices[b]) = b;
+
+    _moves.stamp(a);
+    _moves.stamp(b);
+  }
+
+private:
+  MemoryResource*         _resource;
+  Vector<UniquePtr<Page>> _sparse;
+  Vector<uint32_t>        _indices;
+  Vector<Version>         _versions;
+  Vector<T>               _data;
+  Bitset                  _occupancy;
+  MoveStamps              _moves;
+  bool                    _sorted = false;
+  GroupBase*              _group  = nullptr;
+
+  template<typename...> friend class Group;
+};
+
+template<typename T>
+constexpr uint32_t ComponentStore<T, SparseSetStorage>::NONE;
+
+template<typename T> template<typename... Args>
+void ComponentStore<T, SparseSetStorage>::emplace( size_t    index
+                                                 , Version   version
+                                                 , Args&&... args)
+{
+  auto& pos = reserve_for(index);
+
+  if (pos != NONE) {
+    detail::replace(_data[pos], std::forward<Args>(args)...);
+    _versions[pos] = version;
+    return;
+  }
+
+  // std::vector::emplace_back is safe even when args refer to an element of
+  // the same vector.
+  _data.emplace_back(std::forward<Args>(args)...);
+  _indices.push_back(static_cast<uint32_t>(index));
+  _versions.push_back(version);
+  _occupancy.set(index);
+
+  pos = static_cast<uint32_t>(_indices.size() - 1);
+}
+
+template<typename T>
+void ComponentStore<T, SparseSetStorage>::erase(size_t index) {
+  auto pos = position(index);
+  if (pos == NONE) return;
+
+  auto last = _indices.size() - 1;
+
+  if (pos != last) {
+    _data[pos]     = std::move(_data[last]);
+    _indices[pos]  = _indices[last];
+    _versions[pos] = _versions[last];
+
+    sparse(_indices[pos]) = pos;
+    _moves.stamp(pos);
+  }
+
+  _data.pop_back();
+  _indices.pop_back();
+  _versions.pop_back();
+
+  sparse(index) = NONE;
+  _occupancy.reset(index);
+}
+
+template<typename T>
+void ComponentStore<T, SparseSetStorage>::relocate( size_t  from
+                                                  , size_t  to
+                                                  , Version version)
+{
+  auto pos = position(from);
+  if (pos == NONE) return;
+  assert(!contains(to));
+
+  reserve_for(to) = pos;
+  sparse(from)    = NONE;
+
+  _indices[pos]  = static_cast<uint32_t>(to);
+  _versions[pos] = version;
+
+  _occupancy.reset(from);
+  _occupancy.set(to);
+}
+
+template<typename T>
+void ComponentStore<T, SparseSetStorage>::shrink_to_fit() {
+  constexpr size_t PAGE_WORDS = PAGE_SIZE / Bitset::WORD_BITS;
+
+  for (size_t p = 0; p < _sparse.size(); ++p) {
+    if (!_sparse[p]) continue;
+
+    auto empty = true;
+
+    for (size_t i = p * PAGE_WORDS; i < (p + 1) * PAGE_WORDS; ++i) {
+      if (_occupancy.word(i)) {
+        empty = false;
+        break;
+      }
+    }
+
+    if (empty) _sparse[p].reset();
+  }
+
+  while (!_sparse.empty() && !_sparse.back()) {
+    _sparse.pop_back();
+  }
+
+  _sparse.shrink_to_fit();
+  _indices.shrink_to_fit();
+  _versions.shrink_to_fit();
+  _data.shrink_to_fit();
+  _occupancy.shrink_to_fit();
+  _moves.truncate(_indices.size());
+}
+
+template<typename T> template<typename Compare>
+void ComponentStore<T, SparseSetStorage>::sort(Compare compare) {
+  assert(!_group && "sorting store owned by a Group");
+
+  Vector<uint32_t> order(_data.size(), 0, _data.get_allocator());
+
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+
+  // Reversed, as the dense arrays are iterated backwards.
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return compare(_data[b], _data[a]);
+  });
+
+  // Apply the permutation by following its cycles. Position i is to receive
+  // the component at order[i].
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    auto current = i;
+
+    while (order[current] != i) {
+      auto next = order[current];
+      swap_positions(current, next);
+      order[current] = current;
+      current = next;
+    }
+
+    order[current] = current;
+  }
+
+  _sorted = true;
+}
+
+template<typename T> template<typename S>
+void ComponentStore<T, SparseSetStorage>::follow(const S& leader) {
+  assert(!_group && "sorting store owned by a Group");
+
+  auto& indices = leader.indices();
+  auto  top     = static_cast<uint32_t>(_indices.size());
+
+  for (auto i = indices.size(); i > 0 && top > 0; --i) {
+    auto pos = position(indices[i - 1]);
+    if (pos == NONE) continue;
+
+    swap_positions(pos, --top);
+  }
+}
+
+} // namespace secs
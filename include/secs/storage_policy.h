@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+// Storage policies select how a ComponentStore lays out the components of a
+// given type. The policy is chosen per component type by specializing
+// StoragePolicy:
+//
+//   namespace secs {
+//     template<> struct StoragePolicy<Foo> { using type = SparseSetStorage; };
+//   }
+
+namespace secs {
+
+// Components are stored in pages indexed directly by the Entity index. Fast
+// random access, but memory scales with the number of Entities in the
+// Container. Default.
+struct PagedStorage {};
+
+// Components are stored packed in a dense array, with a sparse index mapping
+// Entity indices to positions in it. Memory and iteration scale with the
+// number of owners, so this suits components owned by few Entities. Requires
+// the component type to be move constructible and move assignable.
+struct SparseSetStorage {};
+
+// Only membership is stored, as a bit per Entity. All components share a
+// single instance. Default for empty trivial types (tags).
+struct TagStorage {};
+
+// Like PagedStorage, but address space for the pages of Capacity Entities is
+// reserved up front and pages are committed as needed, so growing never copies
+// or relocates anything. Memory of pages left empty can be returned to the OS
+// with Container::shrink_to_fit().
+template<size_t Capacity>
+struct VirtualStorage {};
+
+template<typename T>
+struct StoragePolicy {
+  using type = std::conditional_t< std::is_empty<T>::value
+                                && std::is_trivial<T>::value
+                                 , TagStorage
+                                 , PagedStorage>;
+};
+
+template<typename T, typename = typename StoragePolicy<T>::type>
+class ComponentStore;
+
+template<typename T>
+constexpr bool IsSparseSetStored = std::is_same< typename StoragePolicy<T>::type
+                                               , SparseSetStorage>::value;
+
+template<typename T>
+constexpr bool IsTagStored = std::is_same< typename StoragePolicy<T>::type
+                                         , TagStorage>::value;
+
+namespace detail {
+template<typename> struct IsPaged               : std::false_type {};
+template<>         struct IsPaged<PagedStorage> : std::true_type  {};
+
+template<size_t Capacity>
+struct IsPaged<VirtualStorage<Capacity>> : std::true_type {};
+} // namespace detail
+
+// Components of consecutive Entity indices are adjacent in memory, within
+// pages of ComponentStore<T>::PAGE_SIZE Entities.
+template<typename T>
+constexpr bool IsPageStored = detail::IsPaged<
+  typename StoragePolicy<T>::type>::value;
+
+} // namespace secs
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "secs/bitset.h"
+#include "secs/component_store.h"
+#include "secs/memory_resource.h"
+#include "secs/storage_policy.h"
+#include "secs/version.h"
+
+namespace secs {
+
+// Storage for components of an empty trivial type T (a tag). Only a bit per
+// Entity index is stored, so adding or removing a tag is a bit flip.
+//
+// A component always has the version of its owning Entity, so instead of
+// storing versions, the store checks them against the versions of the
+// Entities in the Container, which are bound on first emplace.
+template<typename T>
+class ComponentStore<T, TagStorage> {
+  static_assert( std::is_empty<T>::value && std::is_trivial<T>::value
+               , "TagStorage requires empty trivial component type");
+
+public:
+  ComponentStore() = default;
+
+  explicit ComponentStore(MemoryResource& resource)
+    : _occupancy(resource)
+  {}
+
+  ComponentStore(const ComponentStore&) = delete;
+  ComponentStore(ComponentStore&&) = default;
+
+  ComponentStore& operator = (const ComponentStore&) = delete;
+  ComponentStore& operator = (ComponentStore&&) = default;
+
+  size_t size() const {
+    return _occupancy.word_count() * Bitset::WORD_BITS;
+  }
+
+  bool contains(size_t index, Version version) const {
+    return _occupancy.test(index) && (*_versions)[index] == version;
+  }
+
+  bool contains(size_t index) const {
+    return _occupancy.test(index);
+  }
+
+  // Bit per Entity index, set if the store contains a component for it.
+  const Bitset& occupancy() const {
+    return _occupancy;
+  }
+
+  T& get(size_t index) {
+    assert(contains(index));
+    (void) index;
+    return _value;
+  }
+
+  const T& get(size_t index) const {
+    assert(contains(index));
+    (void) index;
+    return _value;
+  }
+
+  // Bind the versions of the Entities of the Container.
+  void bind(const Vector<Version>& versions) {
+    _versions = &versions;
+  }
+
+  // Trivial empty objects are indistinguishable, so the arguments are not
+  // needed.
+  template<typename... Args>
+  void emplace(size_t index, Version version, Args&&...) {
+    assert(_versions);
+    assert((*_versions)[index] == version);
+    (void) version;
+
+    _occupancy.set(index);
+  }
+
+  void erase(size_t index) {
+    _occupancy.reset(index);
+  }
+
+  void relocate(size_t from, size_t to, Version) {
+    if (!contains(from)) return;
+
+    _occupancy.reset(from);
+    _occupancy.set(to);
+  }
+
+  void shrink_to_fit() {
+    _occupancy.shrink_to_fit();
+  }
+
+private:
+  Bitset                      _occupancy;
+  const Vector<Version>* _versions = nullptr;
+  T                           _value;
+};
+
+namespace detail {
+
+template<typename S>
+void bind(S&, const Vector<Version>&) {}
+
+template<typename T>
+void bind(ComponentStore<T, TagStorage>& store, const Vector<Version>& versions) {
+  store.bind(versions);
+}
+
+} // namespace detail
+} // namespace secs
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace secs {
+
+// Fixed set of threads running batches of tasks. Every thread has its own
+// queue of tasks, and steals from the other queues when its own is empty.
+class ThreadPool {
+public:
+  // Run tasks on the given number of threads, counting the thread calling
+  // run(), which works too. A pool of one thread runs everything on the caller.
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator = (const ThreadPool&) = delete;
+
+  // Number of threads running tasks, including the caller of run().
+  size_t size() const {
+    return _workers.size() + 1;
+  }
+
+  // Call task(i) for each i in [0, count) and wait until all the calls return.
+  // The indices are split into contiguous blocks, one per queue, and taken from
+  // the front by the owner of the queue, or stolen from the back by the other
+  // threads. run() can be called from a task. Tasks must not throw.
+  template<typename F>
+  void run(size_t count, F&& task) {
+    run(count, &call<std::remove_reference_t<F>>, &task);
+  }
+
+private:
+  using Call = void (*)(void* task, size_t index);
+
+  template<typename F>
+  static void call(void* task, size_t index) {
+    (*static_cast<F*>(task))(index);
+  }
+
+  struct Job {
+    Call                call;
+    void*               task;
+    std::atomic<size_t> remaining;
+  };
+
+  struct Task {
+    Job*   job;
+    size_t index;
+  };
+
+  struct Queue {
+    std::mutex       mutex;
+    std::deque<Task> tasks;
+  };
+
+  void run(size_t count, Call call, void* task);
+  void work(size_t queue);
+
+  // Take a task from the front of the queue, or steal one from the back of
+  // another.
+  bool take(size_t queue, Task& task);
+  void execute(const Task& task);
+
+  // Queue of the calling thread. Threads not owned by the pool share the last
+  // queue.
+  size_t home() const;
+
+private:
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread>            _workers;
+
+  std::atomic<size_t>                 _queued;
+  std::mutex                          _mutex;
+  std::condition_variable             _wake;
+  bool                                _stop = false;
+};
+
+} // namespace secs
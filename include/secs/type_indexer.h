@@ -1,71 +1,36 @@
 #pragma once
 
-#include <algorithm>
-#include <vector>
+#include <cstddef>
 
 namespace secs {
+namespace detail {
+size_t next_type_id();
+} // namespace detail
 
+// Process-wide index of the type T. The indices are assigned on first use, in
+// order starting from 0, so they are useful for indexing arrays. Obtaining the
+// index of a type after the first time is a load of a static.
 //
-// Helper struct that maps types to integer indices. The indices are assigned
-// in order, starting from 0, so they are useful for indexing arrays.
+// Note: types used across shared library boundaries may get different indices
+// in each library.
+template<typename T>
+size_t type_id() {
+  static const size_t id = detail::next_type_id();
+  return id;
+}
+
+//
+// Helper struct that maps types to integer indices, using type_id.
 //
 // Examples:
 //   TypeIndex ti;
 //   assert(ti.get<Foo>() == ti.get<Foo>());
 //   assert(ti.get<Bar>() != ti.get<Foo>());
 //
-//
-// TODO: optimize this
 struct TypeIndexer {
-private:
-  typedef void (*Key)();
-
-  template<typename T>
-  struct KeyGen {
-    static void dummy() {}
-    static constexpr Key value() {
-      return &dummy;
-    }
-  };
-
-  struct KeyComparer {
-    bool operator () ( const std::pair<Key, size_t>& a
-                     , const std::pair<Key, size_t>& b) const
-    {
-      return a.first < b.first;
-    }
-
-    bool operator () (const std::pair<Key, size_t>& a, Key b) const {
-      return a.first < b;
-    }
-
-    bool operator () (Key a, const std::pair<Key, size_t>& b) const {
-      return a < b.first;
-    }
-  };
-
-
-  // Sorted vector so we can look stuff up using binary search
-  // (lower_bound/upper_bound algorithms)
-  mutable std::vector<std::pair<Key, size_t>> _map;
-  mutable size_t _next = 0;
-
-public:
-
   template<typename T>
   size_t get() const {
-    auto key = KeyGen<T>::value();
-    auto it = std::lower_bound(_map.begin(), _map.end(), key, KeyComparer());
-
-    if (it == _map.end() || it->first != key) {
-      it = _map.insert( std::upper_bound( _map.begin()
-                                        , _map.end()
-                                        , key
-                                        , KeyComparer())
-                      , { key, _next++ });
-    }
-
-    return it->second;
+    return type_id<T>();
   }
 };
 
@@ -1,9 +1,14 @@
 #pragma once
 
-#include <vector>
+#include <type_traits>
+#include "secs/memory_resource.h"
 #include "secs/type_indexer.h"
 
 // Map-like container where keys are types.
+//
+// The values are indexed by type_id, so a map holds a value for every type id
+// up to the largest one stored in it: its size grows with the number of types
+// used in the whole program, not only with those stored.
 
 namespace secs {
 
@@ -13,11 +18,17 @@ class TypeKeyedMap {
 
 public:
 
-  using iterator       = typename std::vector<V>::iterator;
-  using const_iterator = typename std::vector<V>::const_iterator;
+  using iterator       = typename Vector<V>::iterator;
+  using const_iterator = typename Vector<V>::const_iterator;
 
 public:
 
+  TypeKeyedMap() = default;
+
+  explicit TypeKeyedMap(MemoryResource& resource)
+    : _values(resource)
+  {}
+
   iterator begin() { return _values.begin(); }
   iterator end()   { return _values.end(); }
 
@@ -26,13 +37,13 @@ public:
 
   template<typename T>
   V* find() {
-    auto index = _type_indexer.get<T>();
+    auto index = type_id<T>();
     return index < _values.size() ? &_values[index] : nullptr;
   }
 
   template<typename T>
   const V* find() const {
-    auto index = _type_indexer.get<T>();
+    auto index = type_id<T>();
     return index < _values.size() ? &_values[index] : nullptr;
   }
 
@@ -58,7 +69,7 @@ private:
 
   template<typename T>
   size_t reserve() {
-    auto index = _type_indexer.get<T>();
+    auto index = type_id<T>();
 
     if (index >= _values.size()) {
       _values.resize(index + 1);
@@ -68,8 +79,7 @@ private:
   }
 
 private:
-  TypeIndexer     _type_indexer;
-  std::vector<V>  _values;
+  Vector<V>  _values;
 };
 
 } // namespace secs
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+namespace secs {
+
+// Range of virtual address space reserved up front. Nothing is backed by
+// physical memory until committed, and committed ranges can be returned to the
+// OS again with decommit. Offsets and sizes must be multiples of page_size().
+class VirtualRegion {
+public:
+  VirtualRegion() = default;
+
+  // Reserve at least size bytes of address space. Throws std::bad_alloc.
+  explicit VirtualRegion(size_t size);
+
+  ~VirtualRegion();
+
+  VirtualRegion(const VirtualRegion&) = delete;
+  VirtualRegion(VirtualRegion&&) noexcept;
+
+  VirtualRegion& operator = (const VirtualRegion&) = delete;
+  VirtualRegion& operator = (VirtualRegion&&) noexcept;
+
+  char* data() const {
+    return _data;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  // Make the range readable and writable. Throws std::bad_alloc.
+  void commit(size_t offset, size_t size);
+
+  // Discard the contents of the range, release its physical memory and make
+  // it inaccessible. Committing it again yields zeroed memory. Throws
+  // std::system_error when the range cannot be made inaccessible, leaving it
+  // committed and zeroed.
+  void decommit(size_t offset, size_t size);
+
+  // Granularity of commit and decommit.
+  static size_t page_size();
+
+private:
+  char*  _data = nullptr;
+  size_t _size = 0;
+};
+
+} // namespace secs
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#include "secs/bitset.h"
+#include "secs/component_store.h"
+#include "secs/memory_resource.h"
+#include "secs/storage_policy.h"
+#include "secs/version.h"
+#include "secs/virtual_region.h"
+
+namespace secs {
+
+// Storage for all Components of type T in a Container, for at most Capacity
+// Entities.
+//
+// The layout is the same as with PagedStorage, but all pages live in a single
+// VirtualRegion reserved on construction. A page is committed when a component
+// is first emplaced into it, so untouched pages cost no memory, and components
+// are never relocated. shrink_to_fit() decommits pages with no components.
+template<typename T, size_t Capacity>
+class ComponentStore<T, VirtualStorage<Capacity>> {
+public:
+  static constexpr size_t PAGE_SHIFT = 10;
+  static constexpr size_t PAGE_SIZE  = size_t(1) << PAGE_SHIFT;
+  static constexpr size_t PAGE_COUNT = (Capacity + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+  ComponentStore()
+    : ComponentStore(*new_delete_resource())
+  {}
+
+  explicit ComponentStore(MemoryResource& resource)
+    : _stride(stride())
+    , _region(PAGE_COUNT * _stride)
+    , _committed(resource)
+    , _occupancy(resource)
+  {}
+
+  ComponentStore(const ComponentStore&) = delete;
+  ComponentStore(ComponentStore&&) = delete;
+
+  ~ComponentStore() {
+    for (size_t p = 0; p < _page_end; ++p) {
+      if (!_committed.test(p)) continue;
+
+      auto& page = this->page(p);
+
+      for (size_t i = 0; i < PAGE_SIZE; ++i) {
+        if (page.versions[i].exists()) page.ptr(i)->~T();
+      }
+
+      page.~Page();
+    }
+  }
+
+  ComponentStore& operator = (const ComponentStore&) = delete;
+  ComponentStore& operator = (ComponentStore&&) = delete;
+
+  size_t size() const {
+    return _page_end << PAGE_SHIFT;
+  }
+
+  // Number of pages backed by memory.
+  size_t committed_pages() const {
+    return _committed_count;
+  }
+
+  bool contains(size_t index, Version version) const {
+    auto p = index >> PAGE_SHIFT;
+    return p < _page_end
+        && _committed.test(p)
+        && page(p).versions[offset(index)] == version;
+  }
+
+  bool contains(size_t index) const {
+    return _occupancy.test(index);
+  }
+
+  // Bit per Entity index, set if the store contains a component for it.
+  const Bitset& occupancy() const {
+    return _occupancy;
+  }
+
+  T& get(size_t index) {
+    assert(contains(index));
+    return *page(index >> PAGE_SHIFT).ptr(offset(index));
+  }
+
+  const T& get(size_t index) const {
+    assert(contains(index));
+    return *page(index >> PAGE_SHIFT).ptr(offset(index));
+  }
+
+  template<typename... Args>
+  void emplace(size_t index, Version version, Args&&... args);
+
+  void erase(size_t index) {
+    if (!contains(index)) return;
+
+    auto& page = this->page(index >> PAGE_SHIFT);
+    page.ptr(offset(index))->~T();
+    page.versions[offset(index)].destroy();
+    _occupancy.reset(index);
+  }
+
+  // Move the component of Entity index from to the free index to.
+  void relocate(size_t from, size_t to, Version version) {
+    if (!contains(from)) return;
+    assert(!contains(to));
+
+    auto& target = reserve_for(to);
+    detail::move_construct(target.ptr(offset(to)), get(from));
+    target.versions[offset(to)] = version;
+    _occupancy.set(to);
+
+    erase(from);
+  }
+
+  // Decommit all pages which contain no components, returning their memory
+  // to the OS.
+  void shrink_to_fit();
+
+private:
+  using Slot = detail::Store<T>;
+
+  struct Page {
+    Page() {}
+
+    Version versions[PAGE_SIZE];
+    Slot    data[PAGE_SIZE];
+
+    T* ptr(size_t offset) {
+      return reinterpret_cast<T*>(data + offset);
+    }
+
+    const T* ptr(size_t offset) const {
+      return reinterpret_cast<const T*>(data + offset);
+    }
+  };
+
+  static constexpr size_t PAGE_WORDS = PAGE_SIZE / Bitset::WORD_BITS;
+
+  // Distance between pages, rounded up to whole pages of the OS.
+  static size_t stride() {
+    auto os_page = VirtualRegion::page_size();
+    return (sizeof(Page) + os_page - 1) / os_page * os_page;
+  }
+
+  static size_t offset(size_t index) {
+    return index & (PAGE_SIZE - 1);
+  }
+
+  Page& page(size_t p) {
+    return *reinterpret_cast<Page*>(_region.data() + p * _stride);
+  }
+
+  const Page& page(size_t p) const {
+    return *reinterpret_cast<const Page*>(_region.data() + p * _stride);
+  }
+
+  bool empty_page(size_t p) const {
+    for (size_t i = p * PAGE_WORDS; i < (p + 1) * PAGE_WORDS; ++i) {
+      if (_occupancy.word(i)) return false;
+    }
+
+    return true;
+  }
+
+  Page& reserve_for(size_t index) {
+    auto p = index >> PAGE_SHIFT;
+
+    if (p >= PAGE_COUNT) {
+      throw std::out_of_range("Entity index exceeds VirtualStorage capacity");
+    }
+
+    if (!_committed.test(p)) {
+      _region.commit(p * _stride, _stride);
+      new (&page(p)) Page;
+      _committed.set(p);
+      ++_committed_count;
+    }
+
+    if (p >= _page_end) {
+      _page_end = p + 1;
+    }
+
+    return page(p);
+  }
+
+private:
+  size_t        _stride;
+  VirtualRegion _region;
+  Bitset        _committed;
+  size_t        _committed_count = 0;
+  size_t        _page_end = 0;
+  Bitset        _occupancy;
+};
+
+template<typename T, size_t Capacity> template<typename... Args>
+void ComponentStore<T, VirtualStorage<Capacity>>::emplace( size_t    index
+                                                         , Version   version
+                                                         , Args&&... args)
+{
+  auto& page = reserve_for(index);
+  auto  i    = offset(index);
+
+  if (page.versions[i].exists()) {
+    detail::replace(*page.ptr(i), std::forward<Args>(args)...);
+  } else {
+    new (page.ptr(i)) T(std::forward<Args>(args)...);
+    _occupancy.set(index);
+  }
+
+  page.versions[i] = version;
+}
+
+template<typename T, size_t Capacity>
+void ComponentStore<T, VirtualStorage<Capacity>>::shrink_to_fit() {
+  for (size_t p = 0; p < _page_end; ++p) {
+    if (!_committed.test(p) || !empty_page(p)) continue;
+
+    // Versions of erased components are discarded as well. That is fine,
+    // because the decommitted page is zeroed, and a zero Version never
+    // matches an existing Entity.
+    // The page is forgotten first, so that the store stays consistent when
+    // decommitting throws.
+    page(p).~Page();
+    _committed.reset(p);
+    --_committed_count;
+    _region.decommit(p * _stride, _stride);
+  }
+
+  _occupancy.shrink_to_fit();
+}
+
+} // namespace secs
@@ -0,0 +1,182 @@
+#include <cassert>
+#include <tuple>
+#include "secs/archetype_index.h"
+
+using namespace secs;
+
+constexpr uint32_t ArchetypeIndex::NONE;
+
+ArchetypeIndex::ArchetypeIndex(MemoryResource& resource)
+  : _resource(&resource)
+  , _locations(resource)
+  , _archetypes(resource)
+  , _lookup(0, BitsetHash(), std::equal_to<Bitset>(), resource)
+  , _matches(0, BitsetHash(), std::equal_to<Bitset>(), resource)
+{
+  find_or_create(Bitset());
+}
+
+void ArchetypeIndex::insert(size_t entity) {
+  if (entity >= _locations.size()) {
+    _locations.resize(entity + 1);
+  }
+
+  assert(!contains(entity));
+  move(entity, 0);
+}
+
+void ArchetypeIndex::erase(size_t entity) {
+  if (!contains(entity)) return;
+
+  detach(entity);
+  _locations[entity].archetype = NONE;
+}
+
+void ArchetypeIndex::add(size_t entity, size_t type) {
+  if (!contains(entity)) return;
+  move(entity, transition(_locations[entity].archetype, type, true));
+}
+
+void ArchetypeIndex::remove(size_t entity, size_t type) {
+  if (!contains(entity)) return;
+  move(entity, transition(_locations[entity].archetype, type, false));
+}
+
+void ArchetypeIndex::relocate(size_t entity, size_t to) {
+  if (!contains(entity)) return;
+
+  if (to >= _locations.size()) {
+    _locations.resize(to + 1);
+  }
+
+  assert(!contains(to));
+
+  auto location = _locations[entity];
+  _archetypes[location.archetype]->entities[location.row] =
+    static_cast<uint32_t>(to);
+
+  _locations[to] = location;
+  _locations[entity].archetype = NONE;
+}
+
+void ArchetypeIndex::truncate(size_t size) {
+  if (size >= _locations.size()) return;
+
+  for (size_t i = size; i < _locations.size(); ++i) {
+    assert(!contains(i));
+  }
+
+  _locations.resize(size);
+  _locations.shrink_to_fit();
+}
+
+const ArchetypeIndex::Tables& ArchetypeIndex::match( const Bitset& required
+                                                   , const Bitset& excluded)
+{
+  auto outer = _matches.find(required);
+
+  if (outer == _matches.end()) {
+    outer = _matches.emplace( std::piecewise_construct
+                            , std::forward_as_tuple(required, *_resource)
+                            , std::forward_as_tuple( 0, BitsetHash()
+                                                   , std::equal_to<Bitset>()
+                                                   , *_resource)).first;
+  }
+
+  auto& matches = outer->second;
+  auto  it      = matches.find(excluded);
+
+  if (it == matches.end()) {
+    it = matches.emplace( std::piecewise_construct
+                        , std::forward_as_tuple(excluded, *_resource)
+                        , std::forward_as_tuple(*_resource)).first;
+  }
+
+  auto& match = it->second;
+
+  for (; match.checked < _archetypes.size(); ++match.checked) {
+    auto& archetype = *_archetypes[match.checked];
+
+    if ( archetype.signature.includes(required)
+      && !archetype.signature.intersects(excluded))
+    {
+      match.tables.push_back(&archetype.entities);
+    }
+  }
+
+  return match.tables;
+}
+
+uint32_t ArchetypeIndex::find_or_create(const Bitset& signature) {
+  auto it = _lookup.find(signature);
+  if (it != _lookup.end()) return it->second;
+
+  auto id = static_cast<uint32_t>(_archetypes.size());
+
+  _archetypes.push_back(
+    allocate_unique<Archetype>(*_resource, signature, *_resource));
+  _lookup.emplace( std::piecewise_construct
+                 , std::forward_as_tuple(signature, *_resource)
+                 , std::forward_as_tuple(id));
+
+  return id;
+}
+
+uint32_t ArchetypeIndex::transition(uint32_t from, size_t type, bool with) {
+  auto& archetype = *_archetypes[from];
+  auto& edges     = with ? archetype.with : archetype.without;
+
+  if (type < edges.size() && edges[type] != NONE) {
+    return edges[type];
+  }
+
+  auto signature = archetype.signature;
+
+  if (with) {
+    signature.set(type);
+  } else {
+    signature.reset(type);
+  }
+
+  auto to = find_or_create(signature);
+
+  if (type >= edges.size()) {
+    edges.resize(type + 1, NONE);
+  }
+
+  edges[type] = to;
+  return to;
+}
+
+void ArchetypeIndex::move(size_t entity, uint32_t to) {
+  auto& location = _locations[entity];
+  if (location.archetype == to) return;
+
+  if (location.archetype != NONE) {
+    detach(entity);
+  }
+
+  auto& table = _archetypes[to]->entities;
+
+  location.archetype = to;
+  location.row       = static_cast<uint32_t>(table.size());
+  location.moved     = ++_moves;
+
+  table.push_back(static_cast<uint32_t>(entity));
+}
+
+// Remove the Entity from its table, moving the last row into its place.
+void ArchetypeIndex::detach(size_t entity) {
+  auto  location = _locations[entity];
+  auto& table    = _archetypes[location.archetype]->entities;
+
+  auto last = table.back();
+
+  if (last != entity) {
+    table[location.row]    = last;
+    _locations[last].row   = location.row;
+    _locations[last].moved = ++_moves;
+  }
+
+  table.pop_back();
+}
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <functional>
+#include "secs/bitset.h"
+
+using namespace secs;
+
+bool Bitset::none() const {
+  return std::all_of(_words.begin(), _words.end(), [](Word w) {
+    return w == 0;
+  });
+}
+
+void Bitset::shrink_to_fit() {
+  while (!_words.empty() && _words.back() == 0) {
+    _words.pop_back();
+  }
+
+  _words.shrink_to_fit();
+}
+
+bool Bitset::includes(const Bitset& other) const {
+  for (size_t i = 0; i < other._words.size(); ++i) {
+    if ((word(i) & other._words[i]) != other._words[i]) return false;
+  }
+
+  return true;
+}
+
+bool Bitset::intersects(const Bitset& other) const {
+  auto n = std::min(_words.size(), other._words.size());
+
+  for (size_t i = 0; i < n; ++i) {
+    if (_words[i] & other._words[i]) return true;
+  }
+
+  return false;
+}
+
+size_t Bitset::hash() const {
+  // Trailing zero words must not affect the hash, because they don't affect
+  // equality.
+  size_t result = 0;
+  std::hash<Word> hasher;
+
+  for (size_t i = 0; i < _words.size(); ++i) {
+    if (_words[i] == 0) continue;
+    result ^= hasher(_words[i]) + 0x9e3779b9 + (i << 6) + (i >> 2);
+  }
+
+  return result;
+}
+
+namespace secs {
+
+bool operator == (const Bitset& a, const Bitset& b) {
+  auto n = std::max(a._words.size(), b._words.size());
+
+  for (size_t i = 0; i < n; ++i) {
+    if (a.word(i) != b.word(i)) return false;
+  }
+
+  return true;
+}
+
+} // namespace secs
@@ -4,7 +4,45 @@
 
 using namespace secs;
 
+Container::Container()
+  : Container(Engine::stores, *new_delete_resource())
+{}
+
+Container::Container(Engine engine)
+  : Container(engine, *new_delete_resource())
+{}
+
+Container::Container(MemoryResource& resource)
+  : Container(Engine::stores, resource)
+{}
+
+Container::Container(Engine engine, MemoryResource& resource)
+  : _resource(&resource)
+  , _holes(resource)
+  , _versions(resource)
+  , _occupancy(resource)
+  , _signatures(resource)
+  , _stores(resource)
+  , _groups(resource)
+  , _type_indices(resource)
+  , _ops(resource)
+  , _queries(resource)
+  , _query_order(resource)
+  , _query_types(resource)
+  , _signals(resource)
+  , _routers(resource)
+  , _queues(resource)
+  , _queue_order(resource)
+{
+  if (engine == Engine::archetypes) {
+    _archetypes = allocate_unique<ArchetypeIndex>(resource, resource);
+  }
+}
+
 Container::~Container() {
+  // The queries are destroyed along with the Container, they need no updates.
+  _query_types.clear();
+
   for (auto e : entities()) {
     e.destroy();
   }
@@ -21,27 +59,147 @@ Entity Container::create() {
   }
 
   if (index >= _versions.size()) {
-    _versions.resize(index + 1);
+    _versions.resize(index + 1, _retired);
   }
 
   _versions[index].create();
+  _occupancy.set(index);
+  ++_generation;
+
+  if (_archetypes) {
+    _archetypes->insert(index);
+  }
 
   return Entity(*this, index, _versions[index]);
 }
 
 void Container::destroy(const Entity& entity) {
-  for (auto& ops : _ops) {
-    ops.destroy(entity);
+  // Removing the Entity from the archetype index first avoids moving it
+  // through an archetype per destroyed component.
+  if (_archetypes) {
+    _archetypes->erase(entity._index);
   }
 
+  _signatures.each(entity._index, [&](size_t type) {
+    _ops[type].destroy(entity);
+  });
+
+  _signatures.clear(entity._index);
   _holes.push_back(entity._index);
   _versions[entity._index].destroy();
+  _occupancy.reset(entity._index);
+  ++_generation;
 }
 
 void Container::copy(const Entity& source, const Entity& target) {
   assert(source._container == this);
 
+  _signatures.each(source._index, [&](size_t type) {
+    _ops[type].copy(source, target);
+  });
+}
+
+void Container::dispatch() {
+  if (_dispatching) return;
+  _dispatching = true;
+
+  bool delivered;
+
+  try {
+    do {
+      delivered = false;
+
+      // Handlers may enqueue events of new types, growing the list.
+      for (size_t i = 0; i < _queue_order.size(); ++i) {
+        auto queue = _queue_order[i];
+        delivered = queue.flush(*this, queue.queue) || delivered;
+      }
+    } while (delivered);
+  } catch (...) {
+    _dispatching = false;
+    throw;
+  }
+
+  _dispatching = false;
+}
+
+void Container::update_queries(size_t type, size_t index) {
+  if (type >= _query_types.size()) return;
+
+  for (auto query : _query_types[type]) {
+    query->update(index);
+  }
+}
+
+void Container::shrink_to_fit() {
   for (auto& ops : _ops) {
-    ops.copy(source, target);
+    ops.shrink_to_fit(*this);
+  }
+}
+
+Vector<Relocation> Container::compact() {
+  Vector<Relocation> result(*_resource);
+
+  auto count = size();
+  auto back  = _capacity;
+
+  // Fill the holes in the front with the Entities from the back.
+  for (size_t front = 0; front < count; ++front) {
+    if (_occupancy.test(front)) continue;
+
+    do { --back; } while (!_occupancy.test(back));
+
+    Entity from(*this, back, _versions[back]);
+    relocate(back, front);
+    result.push_back({ from, Entity(*this, front, _versions[front]) });
+  }
+
+  for (size_t i = count; i < _versions.size(); ++i) {
+    if (_retired < _versions[i]) _retired = _versions[i];
+  }
+
+  _capacity = count;
+  _holes.clear();
+  _holes.shrink_to_fit();
+  _versions.resize(count);
+  _versions.shrink_to_fit();
+  _occupancy.shrink_to_fit();
+  _signatures.truncate(count);
+
+  if (_archetypes) {
+    _archetypes->truncate(count);
+  }
+
+  shrink_to_fit();
+
+  return result;
+}
+
+void Container::relocate(size_t from, size_t to) {
+  assert(_occupancy.test(from));
+  assert(!_occupancy.test(to));
+
+  Entity source(*this, from, _versions[from]);
+
+  _versions[to].create();
+  Entity target(*this, to, _versions[to]);
+
+  _signatures.each(from, [&](size_t type) {
+    _ops[type].relocate(source, target);
+  });
+
+  _signatures.move(from, to);
+
+  for (auto query : _query_order) {
+    query->relocate(from, to);
+  }
+
+  _versions[from].destroy();
+  _occupancy.reset(from);
+  _occupancy.set(to);
+  ++_generation;
+
+  if (_archetypes) {
+    _archetypes->relocate(from, to);
   }
 }
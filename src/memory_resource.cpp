@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstdint>
+#include "secs/memory_resource.h"
+
+using namespace secs;
+
+namespace {
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Over-aligned blocks are allocated with extra room for the alignment, and the
+// pointer to the whole allocation is stored right before the returned block.
+class NewDeleteResource : public MemoryResource {
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    if (alignment <= alignof(std::max_align_t)) {
+      return ::operator new(bytes);
+    }
+
+    auto raw     = ::operator new(bytes + alignment + sizeof(void*));
+    auto address = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    auto result  = reinterpret_cast<void**>(align_up(address, alignment));
+
+    result[-1] = raw;
+    return result;
+  }
+
+  void do_deallocate(void* p, size_t, size_t alignment) override {
+    if (alignment <= alignof(std::max_align_t)) {
+      ::operator delete(p);
+    } else {
+      ::operator delete(static_cast<void**>(p)[-1]);
+    }
+  }
+};
+
+} // anonymous namespace
+
+MemoryResource* secs::new_delete_resource() noexcept {
+  static NewDeleteResource resource;
+  return &resource;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MonotonicResource::MonotonicResource( size_t          initial_size
+                                    , MemoryResource& upstream)
+  : _upstream(upstream)
+  , _next_size(std::max(initial_size, sizeof(Chunk)))
+{}
+
+MonotonicResource::~MonotonicResource() {
+  release();
+}
+
+void MonotonicResource::release() {
+  while (_chunks) {
+    auto next = _chunks->next;
+    _upstream.deallocate(_chunks, _chunks->size, alignof(std::max_align_t));
+    _chunks = next;
+  }
+
+  _current = nullptr;
+  _left    = 0;
+}
+
+void* MonotonicResource::do_allocate(size_t bytes, size_t alignment) {
+  auto address = reinterpret_cast<uintptr_t>(_current);
+  auto padding = align_up(address, alignment) - address;
+
+  if (!_current || padding + bytes > _left) {
+    // Grow geometrically and make room for the header and the alignment.
+    auto size = std::max( _next_size
+                        , sizeof(Chunk) + alignment - 1 + bytes);
+
+    auto chunk = static_cast<Chunk*>(
+      _upstream.allocate(size, alignof(std::max_align_t)));
+
+    chunk->next = _chunks;
+    chunk->size = size;
+    _chunks     = chunk;
+
+    _current   = reinterpret_cast<char*>(chunk) + sizeof(Chunk);
+    _left      = size - sizeof(Chunk);
+    _next_size = size * 2;
+
+    address = reinterpret_cast<uintptr_t>(_current);
+    padding = align_up(address, alignment) - address;
+  }
+
+  auto result = _current + padding;
+
+  _current += padding + bytes;
+  _left    -= padding + bytes;
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+constexpr size_t PoolResource::LARGEST_BLOCK;
+
+PoolResource::PoolResource(MemoryResource& upstream)
+  : _upstream(upstream)
+  , _chunks(64 * 1024, upstream)
+{}
+
+PoolResource::~PoolResource() {
+  release();
+}
+
+void PoolResource::release() {
+  std::fill(std::begin(_free), std::end(_free), nullptr);
+  _chunks.release();
+}
+
+size_t PoolResource::size_class(size_t bytes, size_t alignment) {
+  size_t result = 0;
+  size_t size   = 8;
+
+  while (size < bytes || size < alignment) {
+    size *= 2;
+    ++result;
+  }
+
+  return result;
+}
+
+void* PoolResource::do_allocate(size_t bytes, size_t alignment) {
+  if (bytes > LARGEST_BLOCK || alignment > LARGEST_BLOCK) {
+    return _upstream.allocate(bytes, alignment);
+  }
+
+  auto c = size_class(bytes, alignment);
+
+  if (auto block = _free[c]) {
+    _free[c] = block->next;
+    return block;
+  }
+
+  // Blocks are aligned to their size.
+  auto size = size_t(8) << c;
+  return _chunks.allocate(size, size);
+}
+
+void PoolResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+  if (bytes > LARGEST_BLOCK || alignment > LARGEST_BLOCK) {
+    _upstream.deallocate(p, bytes, alignment);
+    return;
+  }
+
+  auto c     = size_class(bytes, alignment);
+  auto block = static_cast<Block*>(p);
+
+  block->next = _free[c];
+  _free[c]    = block;
+}
@@ -0,0 +1,16 @@
+#include "secs/query.h"
+
+using namespace secs;
+
+constexpr uint32_t QueryBase::NONE;
+
+void QueryBase::relocate(size_t from, size_t to) {
+  if (!contains(from)) return;
+
+  auto position = _positions[from];
+  _positions[from] = NONE;
+
+  reserve(to);
+  _positions[to]     = position;
+  _indices[position] = static_cast<uint32_t>(to);
+}
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include "secs/query_kernel.h"
+
+#ifdef SECS_X86
+#include <immintrin.h>
+#endif
+
+using namespace secs;
+using namespace secs::detail;
+
+namespace {
+
+using Word = Bitset::Word;
+
+using Kernel = void (*)( const Operand*, size_t
+                       , const Operand*, size_t
+                       , size_t, size_t, Word*);
+
+Word word(const Operand& operand, size_t index) {
+  return index < operand.size ? operand.words[index] : 0;
+}
+
+// Number of words from first on which all the operands have.
+size_t common_size( const Operand* operands
+                  , size_t         operand_count
+                  , size_t         first
+                  , size_t         count)
+{
+  for (size_t i = 0; i < operand_count; ++i) {
+    auto size = operands[i].size > first ? operands[i].size - first : 0;
+    count = std::min(count, size);
+  }
+
+  return count;
+}
+
+#ifdef SECS_X86
+
+__m128i load128(const Operand& operand, size_t index) {
+  return _mm_loadu_si128(
+    reinterpret_cast<const __m128i*>(operand.words + index));
+}
+
+__attribute__((target("avx2")))
+__m256i load256(const Operand& operand, size_t index) {
+  return _mm256_loadu_si256(
+    reinterpret_cast<const __m256i*>(operand.words + index));
+}
+
+#endif // SECS_X86
+
+struct Selected {
+  Kernel      kernel;
+  const char* name;
+};
+
+Selected select() {
+#ifdef SECS_X86
+  if (avx2_supported()) {
+    return { &intersect_avx2, "avx2" };
+  } else {
+    return { &intersect_sse2, "sse2" };
+  }
+#else
+  return { &intersect_scalar, "scalar" };
+#endif
+}
+
+const Selected& selected() {
+  static const Selected result = select();
+  return result;
+}
+
+} // anonymous namespace
+
+void detail::intersect_scalar( const Operand* required
+                             , size_t         required_count
+                             , const Operand* excluded
+                             , size_t         excluded_count
+                             , size_t         first
+                             , size_t         count
+                             , Word*          out)
+{
+  for (size_t k = 0; k < count; ++k) {
+    auto w = word(required[0], first + k);
+
+    for (size_t i = 1; i < required_count; ++i) {
+      w &= word(required[i], first + k);
+    }
+
+    for (size_t i = 0; i < excluded_count; ++i) {
+      w &= ~word(excluded[i], first + k);
+    }
+
+    out[k] = w;
+  }
+}
+
+#ifdef SECS_X86
+
+void detail::intersect_sse2( const Operand* required
+                           , size_t         required_count
+                           , const Operand* excluded
+                           , size_t         excluded_count
+                           , size_t         first
+                           , size_t         count
+                           , Word*          out)
+{
+  auto n = std::min( common_size(required, required_count, first, count)
+                   , common_size(excluded, excluded_count, first, count));
+  n -= n % 2;
+
+  for (size_t k = 0; k < n; k += 2) {
+    auto w = load128(required[0], first + k);
+
+    for (size_t i = 1; i < required_count; ++i) {
+      w = _mm_and_si128(w, load128(required[i], first + k));
+    }
+
+    for (size_t i = 0; i < excluded_count; ++i) {
+      w = _mm_andnot_si128(load128(excluded[i], first + k), w);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), w);
+  }
+
+  intersect_scalar( required, required_count
+                  , excluded, excluded_count
+                  , first + n, count - n, out + n);
+}
+
+__attribute__((target("avx2")))
+void detail::intersect_avx2( const Operand* required
+                           , size_t         required_count
+                           , const Operand* excluded
+                           , size_t         excluded_count
+                           , size_t         first
+                           , size_t         count
+                           , Word*          out)
+{
+  auto n = std::min( common_size(required, required_count, first, count)
+                   , common_size(excluded, excluded_count, first, count));
+  n -= n % 4;
+
+  for (size_t k = 0; k < n; k += 4) {
+    auto w = load256(required[0], first + k);
+
+    for (size_t i = 1; i < required_count; ++i) {
+      w = _mm256_and_si256(w, load256(required[i], first + k));
+    }
+
+    for (size_t i = 0; i < excluded_count; ++i) {
+      w = _mm256_andnot_si256(load256(excluded[i], first + k), w);
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), w);
+  }
+
+  // Avoid AVX-SSE transition penalties in the caller.
+  _mm256_zeroupper();
+
+  intersect_scalar( required, required_count
+                  , excluded, excluded_count
+                  , first + n, count - n, out + n);
+}
+
+bool detail::avx2_supported() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif // SECS_X86
+
+void detail::intersect( const Operand* required
+                      , size_t         required_count
+                      , const Operand* excluded
+                      , size_t         excluded_count
+                      , size_t         first
+                      , size_t         count
+                      , Word*          out)
+{
+  selected().kernel( required, required_count
+                   , excluded, excluded_count
+                   , first, count, out);
+}
+
+size_t detail::collect_runs( const Word* words
+                           , size_t      count
+                           , size_t      base
+                           , IndexRun*   out)
+{
+  size_t n = 0;
+
+  for (size_t w = 0; w < count; ++w) {
+    auto bits   = words[w];
+    auto offset = base + w * Bitset::WORD_BITS;
+
+    while (bits) {
+      auto start = lowest_bit(bits);
+      auto rest  = ~bits & (~Word(0) << start);
+      auto end   = rest ? lowest_bit(rest) : Bitset::WORD_BITS;
+
+      // Join runs crossing a word boundary.
+      if (start == 0 && n > 0 && out[n - 1].first + out[n - 1].count == offset) {
+        out[n - 1].count += static_cast<uint32_t>(end);
+      } else {
+        out[n].first = static_cast<uint32_t>(offset + start);
+        out[n].count = static_cast<uint32_t>(end - start);
+        ++n;
+      }
+
+      bits = end < Bitset::WORD_BITS ? bits & (~Word(0) << end) : 0;
+    }
+  }
+
+  return n;
+}
+
+const char* detail::kernel_name() {
+  return selected().name;
+}
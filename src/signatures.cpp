@@ -0,0 +1,57 @@
+#include <algorithm>
+#include "secs/signatures.h"
+
+using namespace secs;
+
+void Signatures::set(size_t entity, size_t type) {
+  if (type / Bitset::WORD_BITS >= _stride) {
+    restride(type / Bitset::WORD_BITS + 1);
+  }
+
+  if (entity >= rows()) {
+    _words.resize((entity + 1) * _stride);
+  }
+
+  _words[entity * _stride + type / Bitset::WORD_BITS] |= mask(type);
+}
+
+void Signatures::clear(size_t entity) {
+  if (entity >= rows()) return;
+
+  auto row = _words.begin() + entity * _stride;
+  std::fill(row, row + _stride, 0);
+}
+
+void Signatures::move(size_t from, size_t to) {
+  if (from >= rows()) return;
+
+  if (to >= rows()) {
+    _words.resize((to + 1) * _stride);
+  }
+
+  auto source = _words.begin() + from * _stride;
+  std::copy(source, source + _stride, _words.begin() + to * _stride);
+  std::fill(source, source + _stride, 0);
+}
+
+void Signatures::truncate(size_t size) {
+  if (size >= rows()) return;
+
+  _words.resize(size * _stride);
+  _words.shrink_to_fit();
+}
+
+void Signatures::restride(size_t stride) {
+  auto rows = this->rows();
+
+  Vector<Bitset::Word> words(rows * stride, 0, _words.get_allocator());
+
+  for (size_t r = 0; r < rows; ++r) {
+    std::copy( _words.begin() + r * _stride
+             , _words.begin() + (r + 1) * _stride
+             , words.begin() + r * stride);
+  }
+
+  _words.swap(words);
+  _stride = stride;
+}
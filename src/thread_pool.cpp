@@ -0,0 +1,140 @@
+#include <algorithm>
+#include "secs/thread_pool.h"
+
+using namespace secs;
+
+namespace {
+
+// Pool and queue of the current thread, if it is a worker.
+thread_local const ThreadPool* current_pool  = nullptr;
+thread_local size_t            current_queue = 0;
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(size_t threads)
+  : _queued(0)
+{
+  threads = std::max<size_t>(threads, 1);
+
+  for (size_t i = 0; i < threads; ++i) {
+    _queues.emplace_back(new Queue);
+  }
+
+  for (size_t i = 0; i + 1 < threads; ++i) {
+    _workers.emplace_back([this, i]() { work(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+
+  _wake.notify_all();
+
+  for (auto& worker : _workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::run(size_t count, Call call, void* task) {
+  if (count == 0) return;
+
+  Job job;
+  job.call      = call;
+  job.task      = task;
+  job.remaining = count;
+
+  // Counted before pushing, so that the count never drops below zero.
+  _queued += count;
+
+  auto queues = _queues.size();
+
+  for (size_t q = 0; q < queues; ++q) {
+    auto& queue = *_queues[q];
+    auto  first = count * q / queues;
+    auto  last  = count * (q + 1) / queues;
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    for (auto i = first; i < last; ++i) {
+      queue.tasks.push_back({ &job, i });
+    }
+  }
+
+  // Workers test _queued under the mutex before waiting, so taking it here
+  // ensures none of them misses the notification.
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+  }
+
+  _wake.notify_all();
+
+  auto queue = home();
+
+  while (job.remaining.load(std::memory_order_acquire) > 0) {
+    Task next;
+
+    if (take(queue, next)) {
+      execute(next);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ThreadPool::work(size_t queue) {
+  current_pool  = this;
+  current_queue = queue;
+
+  for (;;) {
+    Task next;
+
+    if (take(queue, next)) {
+      execute(next);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wake.wait(lock, [this]() { return _stop || _queued > 0; });
+
+    if (_stop) return;
+  }
+}
+
+bool ThreadPool::take(size_t queue, Task& task) {
+  if (_queued.load(std::memory_order_relaxed) == 0) return false;
+
+  auto queues = _queues.size();
+
+  for (size_t i = 0; i < queues; ++i) {
+    auto& victim = *_queues[(queue + i) % queues];
+
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty()) continue;
+
+    if (i == 0) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+    } else {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+    }
+
+    --_queued;
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::execute(const Task& task) {
+  auto job = task.job;
+  job->call(job->task, task.index);
+  job->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+size_t ThreadPool::home() const {
+  return current_pool == this ? current_queue : _queues.size() - 1;
+}
@@ -0,0 +1,7 @@
+#include <atomic>
+#include "secs/type_indexer.h"
+
+size_t secs::detail::next_type_id() {
+  static std::atomic<size_t> next(0);
+  return next++;
+}
@@ -0,0 +1,62 @@
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "secs/virtual_region.h"
+
+using namespace secs;
+
+VirtualRegion::VirtualRegion(size_t size)
+  : _size((size + page_size() - 1) / page_size() * page_size())
+{
+  auto p = mmap( nullptr, _size, PROT_NONE
+               , MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (p == MAP_FAILED) throw std::bad_alloc();
+
+  _data = static_cast<char*>(p);
+}
+
+VirtualRegion::~VirtualRegion() {
+  if (_data) munmap(_data, _size);
+}
+
+VirtualRegion::VirtualRegion(VirtualRegion&& other) noexcept
+  : _data(other._data)
+  , _size(other._size)
+{
+  other._data = nullptr;
+  other._size = 0;
+}
+
+VirtualRegion& VirtualRegion::operator = (VirtualRegion&& other) noexcept {
+  std::swap(_data, other._data);
+  std::swap(_size, other._size);
+  return *this;
+}
+
+void VirtualRegion::commit(size_t offset, size_t size) {
+  if (mprotect(_data + offset, size, PROT_READ | PROT_WRITE) != 0) {
+    throw std::bad_alloc();
+  }
+}
+
+void VirtualRegion::decommit(size_t offset, size_t size) {
+  // Zero the range by hand if the kernel refuses to drop it, so that it still
+  // reads as zeroed when committed again.
+  if (madvise(_data + offset, size, MADV_DONTNEED) != 0) {
+    std::memset(_data + offset, 0, size);
+  }
+
+  if (mprotect(_data + offset, size, PROT_NONE) != 0) {
+    throw std::system_error(errno, std::generic_category(), "decommit");
+  }
+}
+
+size_t VirtualRegion::page_size() {
+  static const size_t result = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return result;
+}
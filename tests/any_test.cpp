@@ -1,6 +1,8 @@
 #include "catch.hpp"
 #include "secs/any.h"
 
+#include <functional>
+
 // DEBUG
 #include <iostream>
 
@@ -126,3 +128,76 @@ TEST_CASE("Non-copyable types") {
   many.push_back(NonCopyable{});
   many.resize(1024);
 }
+
+namespace {
+
+struct Small {
+  int* moves;
+  int* destroys;
+
+  Small(int* moves, int* destroys)
+    : moves(moves)
+    , destroys(destroys)
+  {}
+
+  Small(Small&& other) noexcept
+    : moves(other.moves)
+    , destroys(other.destroys)
+  {
+    ++*moves;
+  }
+
+  ~Small() {
+    ++*destroys;
+  }
+};
+
+struct Big {
+  char data[64];
+};
+
+} // anonymous namespace
+
+TEST_CASE("Small values are stored inline") {
+  CHECK( Any::is_inline<int>());
+  CHECK( Any::is_inline<Small>());
+  CHECK(!Any::is_inline<Big>());
+  CHECK(!Any::is_inline<Instrument>());
+
+  int moves    = 0;
+  int destroys = 0;
+
+  {
+    Any a;
+    a.emplace<Small>(&moves, &destroys);
+    CHECK(a.contains<Small>());
+    CHECK(moves == 0);
+
+    // Moving the Any relocates the inline value.
+    Any b = std::move(a);
+    CHECK(!a);
+    CHECK(b.contains<Small>());
+    CHECK(moves    == 1);
+    CHECK(destroys == 1);
+
+    Any c;
+    c = std::move(b);
+    CHECK(moves    == 2);
+    CHECK(destroys == 2);
+  }
+
+  CHECK(destroys == 3);
+}
+
+TEST_CASE("Big values are stored on the heap") {
+  Any a;
+  a.emplace<Big>();
+  a.get<Big>().data[63] = 42;
+
+  auto* address = &a.get<Big>();
+
+  Any b = std::move(a);
+  CHECK(b.contains<Big>());
+  CHECK(&b.get<Big>() == address);
+  CHECK(b.get<Big>().data[63] == 42);
+}
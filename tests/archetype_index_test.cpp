@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "secs/archetype_index.h"
+
+using namespace secs;
+
+namespace {
+Bitset types(std::initializer_list<size_t> indices) {
+  Bitset result;
+  for (auto index : indices) result.set(index);
+  return result;
+}
+
+size_t rows(const ArchetypeIndex::Tables& tables) {
+  size_t result = 0;
+  for (auto table : tables) result += table->size();
+  return result;
+}
+} // anonymous namespace
+
+TEST_CASE("ArchetypeIndex") {
+  ArchetypeIndex index(*new_delete_resource());
+
+  for (size_t entity = 0; entity < 6; ++entity) {
+    index.insert(entity);
+    index.add(entity, 0);
+    if (entity % 2) index.add(entity, 1);
+    if (entity % 3 == 0) index.add(entity, 2);
+  }
+
+  // Empty, {0}, {0, 1}, {0, 2}, {0, 1, 2}.
+  CHECK(index.size() == 5);
+
+  auto& all = index.match(types({ 0 }));
+  CHECK(rows(all) == 6);
+  CHECK(rows(index.match(types({ 0, 1 }))) == 3);
+
+  SECTION("excluded types skip whole tables") {
+    auto& without = index.match(types({ 0 }), types({ 1 }));
+    CHECK(without.size() == 2);
+    CHECK(rows(without) == 3);
+
+    auto& neither = index.match(types({ 0 }), types({ 1, 2 }));
+    CHECK(neither.size() == 1);
+    CHECK(rows(neither) == 2);
+
+    // Lists are kept per pair of required and excluded types, and extended
+    // with new archetypes when matched again.
+    index.insert(6);
+    index.add(6, 0);
+    index.add(6, 3);
+
+    CHECK(&index.match(types({ 0 })) == &all);
+    CHECK(&index.match(types({ 0 }), types({ 1 })) == &without);
+    CHECK(rows(without) == 4);
+    CHECK(rows(all) == 7);
+  }
+}
@@ -0,0 +1,35 @@
+#include "catch.hpp"
+#include "secs/bitset.h"
+
+using namespace secs;
+
+TEST_CASE("Bitset") {
+  Bitset a;
+  CHECK(a.none());
+  CHECK_FALSE(a.test(1000));
+
+  a.set(3);
+  a.set(130);
+  CHECK(a.test(3));
+  CHECK(a.test(130));
+  CHECK_FALSE(a.test(4));
+  CHECK(a.word(2) == (Bitset::Word(1) << 2));
+
+  Bitset b;
+  b.set(130);
+  CHECK(a.includes(b));
+  CHECK_FALSE(b.includes(a));
+  CHECK(a.intersects(b));
+  CHECK_FALSE(a.intersects(Bitset()));
+
+  Bitset c;
+  c.set(4);
+  CHECK_FALSE(a.intersects(c));
+
+  // Trailing zero words don't affect equality nor hash.
+  a.reset(3);
+  a.reset(130);
+  CHECK(a.none());
+  CHECK(a == Bitset());
+  CHECK(a.hash() == Bitset().hash());
+}
@@ -0,0 +1,160 @@
+#include "catch.hpp"
+#include "secs/component_store.h"
+
+using namespace secs;
+
+namespace {
+struct Position {
+  int x;
+  int y;
+
+  Position(int x = 0, int y = 0)
+    : x(x), y(y)
+  {}
+};
+
+Version created() {
+  Version v;
+  v.create();
+  return v;
+}
+} // anonymous namespace
+
+TEST_CASE("ComponentStore emplace and erase") {
+  ComponentStore<Position> store;
+  auto v = created();
+
+  CHECK_FALSE(store.contains(0));
+  CHECK_FALSE(store.contains(12345));
+
+  store.emplace(12345, v, 1, 2);
+  CHECK(store.contains(12345));
+  CHECK(store.contains(12345, v));
+  CHECK_FALSE(store.contains(0));
+  CHECK(store.get(12345).x == 1);
+
+  store.erase(12345);
+  CHECK_FALSE(store.contains(12345));
+
+  // Erase is idempotent
+  store.erase(12345);
+  CHECK_FALSE(store.contains(12345));
+}
+
+TEST_CASE("ComponentStore growth does not relocate components") {
+  ComponentStore<Position> store;
+  auto v = created();
+
+  store.emplace(0, v, 1, 2);
+  auto& first = store.get(0);
+
+  for (size_t i = 1; i < 8 * ComponentStore<Position>::PAGE_SIZE; ++i) {
+    store.emplace(i, v, (int) i, 0);
+  }
+
+  CHECK(&first == &store.get(0));
+  CHECK(first.x == 1);
+
+  // Emplacing from a component of the same store.
+  auto last = 100 * ComponentStore<Position>::PAGE_SIZE;
+  store.emplace(last, v, store.get(0));
+  CHECK(store.get(last).x == 1);
+}
+
+TEST_CASE("ComponentStore with SparseSetStorage") {
+  ComponentStore<Position, SparseSetStorage> store;
+  auto v = created();
+
+  store.emplace(5000, v, 1, 0);
+  store.emplace(10,   v, 2, 0);
+  store.emplace(300,  v, 3, 0);
+  CHECK(store.count() == 3);
+  CHECK(store.contains(10, v));
+  CHECK_FALSE(store.contains(11));
+
+  // Replace existing
+  store.emplace(10, v, 4, 0);
+  CHECK(store.count() == 3);
+  CHECK(store.get(10).x == 4);
+
+  // Erase moves the last component into the hole.
+  store.erase(5000);
+  CHECK(store.count() == 2);
+  CHECK_FALSE(store.contains(5000));
+  CHECK(store.get(10).x  == 4);
+  CHECK(store.get(300).x == 3);
+  CHECK(store.indices() == (Vector<uint32_t>{ 300, 10 }));
+
+  // Emplacing from a component of the same store.
+  store.emplace(20, v, store.get(300));
+  CHECK(store.get(20).x == 3);
+}
+
+TEST_CASE("ComponentStore with TagStorage") {
+  struct Tag {};
+  CHECK((std::is_same<StoragePolicy<Tag>::type, TagStorage>::value));
+
+  Vector<Version> versions(100);
+  versions[42].create();
+
+  ComponentStore<Tag> store;
+  store.bind(versions);
+
+  store.emplace(42, versions[42]);
+  CHECK(store.contains(42));
+  CHECK(store.contains(42, versions[42]));
+  CHECK_FALSE(store.contains(41));
+
+  auto old = versions[42];
+  versions[42].destroy();
+  versions[42].create();
+  CHECK_FALSE(store.contains(42, old));
+
+  store.erase(42);
+  CHECK_FALSE(store.contains(42));
+}
+
+TEST_CASE("ComponentStore with VirtualStorage") {
+  ComponentStore<Position, VirtualStorage<1 << 20>> store;
+  auto v = created();
+
+  CHECK(store.committed_pages() == 0);
+  CHECK_FALSE(store.contains(500000, v));
+
+  store.emplace(0, v, 1, 2);
+  auto first = &store.get(0);
+
+  // Only the touched pages are committed.
+  store.emplace(500000, v, 3, 4);
+  CHECK(store.committed_pages() == 2);
+
+  for (size_t i = 1; i < 5000; ++i) {
+    store.emplace(i, v, int(i), 0);
+  }
+
+  // Growth never relocates.
+  CHECK(&store.get(0) == first);
+  CHECK(store.get(0).x == 1);
+  CHECK(store.get(500000).y == 4);
+
+  // Pages with a component are kept.
+  for (size_t i = 1; i < 5000; ++i) {
+    store.erase(i);
+  }
+
+  store.shrink_to_fit();
+  CHECK(store.committed_pages() == 2);
+  CHECK(store.get(0).x == 1);
+
+  store.erase(500000);
+  store.shrink_to_fit();
+  CHECK(store.committed_pages() == 1);
+  CHECK_FALSE(store.contains(500000, v));
+
+  // Decommitted page is committed again on demand.
+  store.emplace(500001, v, 5, 6);
+  CHECK(store.get(500001).x == 5);
+  CHECK_FALSE(store.contains(500000, v));
+
+  CHECK_THROWS_AS(store.emplace(1 << 20, v), const std::out_of_range&);
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+#include "secs/delegate.h"
+
+#include <memory>
+
+using namespace secs;
+
+namespace {
+
+struct Big {
+  int data[32] = {};
+
+  int operator () (int a) const {
+    return a + data[31];
+  }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Delegate basics") {
+  Delegate<int(int)> d;
+  CHECK(!d);
+
+  d = [](int a) { return a * 2; };
+  CHECK(d);
+  CHECK(d(21) == 42);
+
+  d = nullptr;
+  CHECK(!d);
+}
+
+TEST_CASE("Delegate stores small callables inline") {
+  int    offset = 1;
+  auto   add    = [&](int a) { return a + offset; };
+
+  CHECK( Delegate<int(int)>::is_inline<decltype(add)>());
+  CHECK(!Delegate<int(int)>::is_inline<Big>());
+
+  Delegate<int(int)> a = add;
+  Delegate<int(int)> b = std::move(a);
+  CHECK(!a);
+  CHECK(b(1) == 2);
+
+  Big big;
+  big.data[31] = 100;
+
+  Delegate<int(int)> c = big;
+  Delegate<int(int)> d;
+  d = std::move(c);
+  CHECK(!c);
+  CHECK(d(1) == 101);
+}
+
+TEST_CASE("Delegate destroys its callable") {
+  auto counter = std::make_shared<int>(0);
+
+  {
+    Delegate<int()> a = [counter]() { return ++*counter; };
+    CHECK(counter.use_count() == 2);
+
+    Delegate<int()> b = std::move(a);
+    CHECK(counter.use_count() == 2);
+    CHECK(b() == 1);
+
+    b.reset();
+    CHECK(counter.use_count() == 1);
+
+    Delegate<int()> c = [counter]() { return 0; };
+    CHECK(counter.use_count() == 2);
+  }
+
+  CHECK(counter.use_count() == 1);
+}
@@ -88,6 +88,33 @@ TEST_CASE("Lifetime signals") {
   CHECK(destroy_count == 2);
 }
 
+TEST_CASE("Listening to lifetime signals") {
+  Container container;
+  auto e = container.create();
+
+  CHECK_FALSE(container.listening<OnCreate<Position>>());
+
+  // Emitting without handlers does not create the signal.
+  e.create_component<Position>();
+  container.emit(TestEvent{});
+  CHECK_FALSE(container.listening<OnCreate<Position>>());
+  CHECK_FALSE(container.listening<TestEvent>());
+
+  size_t count = 0;
+  auto connection = container.connect<OnCreate<Position>>(
+      [&](auto&) { ++count; });
+  CHECK(container.listening<OnCreate<Position>>());
+
+  e.create_component<Position>();
+  CHECK(count == 1);
+
+  connection.disconnect();
+  CHECK_FALSE(container.listening<OnCreate<Position>>());
+
+  e.create_component<Position>();
+  CHECK(count == 1);
+}
+
 TEST_CASE("Implicit lifetime event handlers") {
   Container container;
   auto e = container.create();
@@ -173,3 +200,94 @@ TEST_CASE("Custom explicit event handlers") {
   CHECK(count0 == 1);
   CHECK(count1 == 1);
 }
+
+TEST_CASE("Queued events") {
+  Container container;
+
+  std::vector<int> received;
+  size_t           test_events = 0;
+
+  struct Number { int value; };
+
+  container.connect<Number>([&](const Number& n) {
+    received.push_back(n.value);
+
+    // Events enqueued by handlers are delivered by the same dispatch.
+    if (n.value == 1) container.enqueue(TestEvent{});
+  });
+
+  container.connect<TestEvent>([&](auto) {
+    ++test_events;
+    container.dispatch();
+  });
+
+  container.enqueue(Number{ 1 });
+  container.enqueue(Number{ 2 });
+  CHECK(received.empty());
+
+  container.dispatch();
+  CHECK(received == (std::vector<int>{ 1, 2 }));
+  CHECK(test_events == 1);
+
+  container.dispatch();
+  CHECK(received.size() == 2);
+  CHECK(test_events == 1);
+}
+
+TEST_CASE("Queued events after a throwing handler") {
+  Container container;
+
+  struct Number { int value; };
+  std::vector<int> received;
+
+  container.connect<Number>([&](const Number& n) {
+    if (n.value == 1) throw std::runtime_error("handler failed");
+    received.push_back(n.value);
+  });
+
+  container.enqueue(Number{ 1 });
+  container.enqueue(Number{ 2 });
+  CHECK_THROWS_AS(container.dispatch(), const std::runtime_error&);
+
+  // The rest of the failed batch is dropped, later events are delivered.
+  container.enqueue(Number{ 3 });
+  container.dispatch();
+  CHECK(received == (std::vector<int>{ 3 }));
+}
+
+TEST_CASE("Explicit event handlers are routed by signature") {
+  Container container;
+
+  size_t count0 = 0;
+  size_t count1 = 0;
+
+  auto e = container.create();
+  e.create_component<ComponentWithCustomHandlers>(count0);
+
+  auto connection =
+    container.connect<TestEventWithEntity, ComponentWithCustomHandlers>();
+  CHECK(container.listening<TestEventWithEntity>());
+
+  container.emit(TestEventWithEntity{ e });
+  CHECK(count0 == 1);
+
+  // Entities without the component are skipped.
+  container.emit(TestEventWithEntity{ container.create() });
+  CHECK(count0 == 1);
+
+  // Routes to other containers use their components, whose type indices
+  // differ.
+  Container other;
+  auto f = other.create();
+  f.create_component<Position>();
+  f.create_component<ComponentWithCustomHandlers>(count1);
+
+  container.emit(TestEventWithEntity{ f });
+  CHECK(count1 == 1);
+
+  connection.disconnect();
+  CHECK_FALSE(container.listening<TestEventWithEntity>());
+
+  container.emit(TestEventWithEntity{ e });
+  CHECK(count0 == 1);
+}
@@ -1,8 +1,21 @@
+#include <algorithm>
 #include "catch.hpp"
 #include "secs.h"
 
 using namespace secs;
 
+namespace {
+struct Rare;
+struct Huge;
+struct Cell;
+}
+
+namespace secs {
+template<> struct StoragePolicy<Rare> { using type = SparseSetStorage; };
+template<> struct StoragePolicy<Huge> { using type = VirtualStorage<1 << 20>; };
+template<> struct StoragePolicy<Cell> { using type = SparseSetStorage; };
+}
+
 namespace {
 struct Position {
   int x;
@@ -21,6 +34,21 @@ public:
   std::string name;
 };
 
+struct Rare {
+  int value;
+  Rare(int value = 0) : value(value) {}
+};
+
+struct Huge {
+  int value;
+  Huge(int value = 0) : value(value) {}
+};
+
+struct Cell {
+  int value;
+  Cell(int value = 0) : value(value) {}
+};
+
 template<typename... Ts>
 void unused(Ts...) {}
 
@@ -462,3 +490,920 @@ TEST_CASE("FilteredEntity conversions") {
 
   unused(e1, e2, e3);
 }
+
+TEST_CASE("Enumerate Entities with sparse-set stored Components") {
+  Container container;
+
+  std::vector<Entity> es;
+  for (int i = 0; i < 100; ++i) {
+    es.push_back(container.create());
+    es.back().create_component<Position>(i, 0);
+  }
+
+  es[3] .create_component<Rare>(3);
+  es[50].create_component<Rare>(50);
+  es[97].create_component<Rare>(97);
+  es[50].destroy_component<Position>();
+
+  CHECK(count(container.entities<Rare>()) == 3);
+  CHECK(count(container.entities<Position, Rare>()) == 2);
+  CHECK(count(container.entities<Optional<Rare>>()) == 100);
+
+  int sum = 0;
+  container.entities<Rare, Position>().each([&](auto& r, auto& p) {
+    CHECK(r.value == p.x);
+    sum += r.value;
+  });
+  CHECK(sum == 100);
+
+  SECTION("destroying Entities while iterating") {
+    for (auto e : container.entities<Rare>()) {
+      e.destroy();
+    }
+
+    CHECK(count(container.entities<Rare>()) == 0);
+    CHECK(container.size() == 97);
+  }
+
+  SECTION("destroying other Entities while iterating") {
+    std::vector<int> visited;
+
+    for (auto e : container.entities<Rare>()) {
+      if (visited.empty()) es[3].destroy();
+      visited.push_back(e.component<Rare>()->value);
+    }
+
+    // The last Entity, moved into the place of the destroyed one, is visited
+    // once.
+    CHECK((visited == std::vector<int>{ 97, 50 }));
+
+    visited.clear();
+    es[50].destroy();
+    es[10].create_component<Rare>(10);
+
+    container.entities<Rare>().each([&](Rare& r) {
+      if (visited.empty()) es[97].destroy();
+      visited.push_back(r.value);
+    });
+
+    CHECK((visited == std::vector<int>{ 10 }));
+  }
+}
+
+TEST_CASE("Enumerate Entities using the archetype engine") {
+  Container container(Engine::archetypes);
+  CHECK(container.engine() == Engine::archetypes);
+
+  auto e0 = container.create();
+  e0.create_component<Position>(0, 0);
+  e0.create_component<Velocity>();
+
+  auto e1 = container.create();
+  e1.create_component<Position>(1, 0);
+
+  auto e2 = container.create();
+  e2.create_component<Name>("hello");
+  e2.create_component<Position>(2, 0);
+
+  container.create();
+
+  CHECK(count(container.entities()) == 4);
+  CHECK(count(container.entities<Position>()) == 3);
+  CHECK(count(container.entities<Position, Velocity>()) == 1);
+  CHECK(count(container.entities<Position, Optional<Velocity>>()) == 3);
+  CHECK(count(container.entities<Optional<Name>>()) == 4);
+
+  e1.create_component<Velocity>();
+  CHECK(count(container.entities<Position, Velocity>()) == 2);
+
+  e0.destroy_component<Velocity>();
+  CHECK(count(container.entities<Position, Velocity>()) == 1);
+  CHECK((container.entities<Position, Velocity>().front() == e1));
+
+  // Replacing a component doesn't change the archetype.
+  e1.create_component<Velocity>();
+  CHECK(count(container.entities<Velocity>()) == 1);
+
+  for (auto e : container.entities<Position>()) {
+    e.destroy();
+  }
+
+  CHECK(count(container.entities<Position>()) == 0);
+  CHECK(container.size() == 1);
+}
+
+TEST_CASE("Entities changing archetype during iteration are visited once") {
+  Container container(Engine::archetypes);
+
+  for (int i = 0; i < 3; ++i) {
+    auto e = container.create();
+    e.create_component<Position>(i, 0);
+    e.create_component<Velocity>();
+  }
+
+  size_t visits = 0;
+
+  for (auto e : container.entities<Position>()) {
+    e.destroy_component<Velocity>();
+    ++visits;
+  }
+
+  CHECK(visits == 3);
+
+  visits = 0;
+
+  container.entities<Position>().each([&](const Entity& e, Position&) {
+    e.create_component<Velocity>();
+    ++visits;
+  });
+
+  CHECK(visits == 3);
+  CHECK(count(container.entities<Position, Velocity>()) == 3);
+
+  // Destroying another Entity moves the last one of the table into its row.
+  std::vector<Entity> order;
+  for (auto e : container.entities<Position>()) order.push_back(e);
+
+  std::vector<int> visited;
+
+  for (auto e : container.entities<Position>()) {
+    if (visited.empty()) order.back().destroy();
+    visited.push_back(e.component<Position>()->x);
+  }
+
+  CHECK(visited.size() == 2);
+  CHECK(visited[0] != visited[1]);
+}
+
+TEST_CASE("Enumerate sparsely owned Components") {
+  Container container;
+
+  std::vector<Entity> es;
+  for (int i = 0; i < 1000; ++i) {
+    es.push_back(container.create());
+    if (i % 37 == 0) es.back().create_component<Position>(i, 0);
+    if (i % 74 == 0) es.back().create_component<Velocity>();
+  }
+
+  CHECK(count(container.entities<Position>()) == 28);
+  CHECK(count(container.entities<Position, Velocity>()) == 14);
+
+  es[0].destroy();
+  es[999].destroy();
+  es[74].destroy_component<Position>();
+  CHECK(count(container.entities<Position>()) == 25);
+  CHECK(count(container.entities<Position, Velocity>()) == 12);
+  CHECK(count(container.entities()) == 998);
+
+  int expected = 37;
+  container.entities<Position>().each([&](auto& p) {
+    CHECK(p.x == expected);
+    expected += (expected + 37 == 74) ? 74 : 37;
+  });
+}
+
+TEST_CASE("Structural changes during iteration are observed") {
+  Container container;
+
+  std::vector<Entity> es;
+  for (int i = 0; i < 10; ++i) {
+    es.push_back(container.create());
+    es.back().create_component<Position>(i, 0);
+  }
+
+  std::vector<int> visited;
+
+  for (auto e : container.entities<Position>()) {
+    auto x = e.component<Position>()->x;
+    visited.push_back(x);
+
+    if (x == 2) es[3].destroy();
+    if (x == 5) es[6].destroy_component<Position>();
+    if (x == 7) es[9].destroy();
+  }
+
+  CHECK(visited == (std::vector<int>{ 0, 1, 2, 4, 5, 7, 8 }));
+}
+
+TEST_CASE("Structural changes during each are observed") {
+  Container container;
+
+  std::vector<Entity> es;
+  for (int i = 0; i < 1000; ++i) {
+    es.push_back(container.create());
+    es.back().create_component<Position>(i, 0);
+  }
+
+  std::vector<int> visited;
+
+  container.entities<Position>().each([&](Position& p) {
+    visited.push_back(p.x);
+    if (p.x % 2 == 0) es[p.x + 1].destroy_component<Position>();
+  });
+
+  CHECK(visited.size() == 500);
+  CHECK(visited.back() == 998);
+}
+
+TEST_CASE("Tag Components") {
+  Container container;
+
+  auto e0 = container.create();
+  auto c0 = e0.create_component<Velocity>();
+  CHECK(c0);
+  CHECK(e0.component<Velocity>());
+
+  e0.destroy();
+  CHECK_FALSE(c0);
+
+  // The new Entity reuses the index of the destroyed one.
+  auto e1 = container.create();
+  auto c1 = e1.create_component<Velocity>();
+  CHECK(c1);
+  CHECK_FALSE(c0);
+
+  auto e2 = e1.copy();
+  CHECK(e2.component<Velocity>());
+  CHECK(count(container.entities<Velocity>()) == 2);
+}
+
+TEST_CASE("Virtual storage components") {
+  Container container;
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 3000; ++i) {
+    es.push_back(container.create());
+    es.back().create_component<Huge>(i);
+    es.back().create_component<Position>();
+  }
+
+  auto first = es[0].component<Huge>().get();
+
+  for (int i = 1; i < 3000; ++i) {
+    es[i].destroy();
+  }
+
+  container.shrink_to_fit();
+
+  CHECK(es[0].component<Huge>().get() == first);
+  CHECK(es[0].component<Huge>()->value == 0);
+  CHECK(count(container.entities<Huge, Position>()) == 1);
+
+  auto e = container.create();
+  e.create_component<Huge>(42);
+  CHECK(e.component<Huge>()->value == 42);
+  CHECK(count(container.entities<Huge>()) == 2);
+}
+
+namespace {
+void check_compact(Engine engine) {
+  Container container(engine);
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 3000; ++i) {
+    auto e = container.create();
+    e.create_component<Position>(i, -i);
+    if (i % 2) e.create_component<Velocity>();
+    if (i % 3) e.create_component<Rare>(i);
+    es.push_back(e);
+  }
+
+  // Keep every tenth Entity.
+  for (int i = 0; i < 3000; ++i) {
+    if (i % 10) es[i].destroy();
+  }
+
+  auto stale = es[2990];
+  auto relocations = container.compact();
+
+  CHECK(container.size() == 300);
+  CHECK(relocations.size() == 270);
+  CHECK_FALSE(stale);
+
+  for (auto& r : relocations) {
+    CHECK_FALSE(r.from);
+    CHECK(r.to);
+
+    auto i = std::find(es.begin(), es.end(), r.from) - es.begin();
+    REQUIRE(i < 3000);
+    es[i] = r.to;
+  }
+
+  for (int i = 0; i < 3000; i += 10) {
+    auto e = es[i];
+    REQUIRE(e);
+    CHECK(e.component<Position>()->x == i);
+    CHECK(bool(e.component<Velocity>()) == bool(i % 2));
+    CHECK(bool(e.component<Rare>()) == bool(i % 3));
+  }
+
+  CHECK(count(container.entities<Position>()) == 300);
+  CHECK(count(container.entities<Position, Velocity>()) == 0);
+  CHECK(count(container.entities<Rare>()) == 200);
+
+  // New Entities reuse neither the indices nor the versions of stale handles.
+  for (int i = 0; i < 3000; ++i) {
+    container.create().create_component<Velocity>();
+  }
+
+  CHECK_FALSE(stale);
+  CHECK(count(container.entities<Velocity>()) == 3000);
+  CHECK(count(container.entities<Position>()) == 300);
+}
+} // anonymous namespace
+
+TEST_CASE("Compact Container") {
+  check_compact(Engine::stores);
+  check_compact(Engine::archetypes);
+}
+
+TEST_CASE("Sort components") {
+  Container container;
+
+  int values[] = { 5, 3, 9, 1, 7, 2, 8 };
+
+  for (int value : values) {
+    auto e = container.create();
+    e.create_component<Position>();
+    e.create_component<Rare>(value);
+    if (value % 2) e.create_component<Cell>(value);
+  }
+
+  container.create().create_component<Cell>(100);
+
+  container.sort<Rare, Cell>([](const Rare& a, const Rare& b) {
+    return a.value < b.value;
+  });
+
+  std::vector<int> visited;
+  container.entities<Position, Rare>().each([&](Position&, Rare& r) {
+    visited.push_back(r.value);
+  });
+  CHECK(visited == (std::vector<int>{ 1, 2, 3, 5, 7, 8, 9 }));
+
+  // Owners of Cell which also own Rare come first, in the order of Rare.
+  visited.clear();
+  for (auto e : container.entities<Cell>()) {
+    visited.push_back(e.component<Cell>()->value);
+  }
+  CHECK(visited == (std::vector<int>{ 1, 3, 5, 7, 9, 100 }));
+
+  container.sort_by<Rare>([](const Rare& r) { return -r.value; });
+
+  visited.clear();
+  for (auto e : container.entities<Cell, Rare>()) {
+    visited.push_back(e.component<Rare>()->value);
+  }
+  CHECK(visited == (std::vector<int>{ 9, 7, 5, 3, 1 }));
+}
+
+TEST_CASE("Queries are driven by the smallest table") {
+  // The visiting order tells which table drives the iteration: dense tables
+  // are walked backwards, scans of the Container go by index.
+  auto order = [](auto entities) {
+    std::vector<int> result;
+    for (auto e : entities) {
+      result.push_back(e.template component<Rare>()->value);
+    }
+    return result;
+  };
+
+  SECTION("the rarer sparse-set stored component, listed second") {
+    Container container;
+    std::vector<Entity> es;
+
+    for (int i = 0; i < 10; ++i) {
+      es.push_back(container.create());
+      es.back().create_component<Cell>(i);
+    }
+
+    for (int i : { 5, 1, 9, 3, 7 }) es[i].create_component<Rare>(i);
+
+    CHECK(order(container.entities<Cell, Rare>())
+          == (std::vector<int>{ 7, 3, 9, 1, 5 }));
+  }
+
+  SECTION("archetype tables with fewer rows than the sparse owners") {
+    Container container(Engine::archetypes);
+    std::vector<Entity> es;
+
+    for (int i = 0; i < 10; ++i) {
+      es.push_back(container.create());
+      es.back().create_component<Rare>(i);
+    }
+
+    for (int i : { 8, 2, 5 }) es[i].create_component<Position>(i);
+
+    CHECK(order(container.entities<Rare, Position>())
+          == (std::vector<int>{ 5, 2, 8 }));
+  }
+
+  SECTION("a sorted component, even with more owners") {
+    Container container;
+    std::vector<Entity> es;
+
+    for (int i = 0; i < 10; ++i) {
+      es.push_back(container.create());
+      es.back().create_component<Cell>(i);
+    }
+
+    for (int i : { 5, 1, 9 }) es[i].create_component<Rare>(i);
+
+    container.sort_by<Cell>([](const Cell& c) { return (c.value * 7) % 10; });
+
+    // Cell values in the order of their keys: 0, 3, 6, 9, 2, 5, 8, 1, 4, 7.
+    CHECK(order(container.entities<Rare, Cell>())
+          == (std::vector<int>{ 9, 5, 1 }));
+  }
+}
+
+TEST_CASE("Group") {
+  Container container;
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 20; ++i) {
+    auto e = container.create();
+    if (i % 2) e.create_component<Rare>(i);
+    if (i % 3) e.create_component<Cell>(i);
+    es.push_back(e);
+  }
+
+  auto& group = container.group<Rare, Cell>();
+  auto& same = container.group<Rare, Cell>();
+  CHECK(&same == &group);
+  CHECK(group.size() == 7);
+
+  auto visit = [&]() {
+    std::vector<int> result;
+
+    container.entities<Rare, Cell>().each([&](Rare& r, Cell& c) {
+      CHECK(r.value == c.value);
+      result.push_back(r.value);
+    });
+
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+
+  CHECK(visit() == (std::vector<int>{ 1, 5, 7, 11, 13, 17, 19 }));
+
+  // Owned stores cannot be sorted.
+  auto by_value = [](const Cell& a, const Cell& b) { return a.value < b.value; };
+  CHECK_THROWS_AS(container.sort<Cell>(by_value), const std::logic_error&);
+  CHECK(visit() == (std::vector<int>{ 1, 5, 7, 11, 13, 17, 19 }));
+
+  // Explicitly required components walk the group too.
+  size_t required = 0;
+  container.entities<Required<Rare>, Cell>().each(
+    [&](const Entity&, Rare& r, Cell& c) {
+      CHECK(r.value == c.value);
+      ++required;
+    });
+  CHECK(required == 7);
+
+  // Maintained incrementally.
+  es[3].create_component<Cell>(3);
+  es[5].destroy_component<Rare>();
+  es[7].destroy();
+  CHECK(group.size() == 6);
+  CHECK(visit() == (std::vector<int>{ 1, 3, 11, 13, 17, 19 }));
+
+  // Other queries are not affected.
+  CHECK(count(container.entities<Rare>()) == 8);
+  CHECK(count(container.entities<Cell>()) == 13);
+
+  // Range-for loops walk the group too, and removing other Entities from it
+  // while iterating visits each Entity once.
+  std::vector<Entity> order;
+  for (auto e : container.entities<Rare, Cell>()) order.push_back(e);
+  CHECK(order.size() == 6);
+
+  std::vector<int> seen;
+  for (auto e : container.entities<Rare, Cell>()) {
+    if (seen.empty()) order.back().destroy_component<Cell>();
+    seen.push_back(e.component<Rare>()->value);
+  }
+
+  std::sort(seen.begin(), seen.end());
+  CHECK(seen.size() == 5);
+  CHECK(std::unique(seen.begin(), seen.end()) == seen.end());
+
+  order.back().create_component<Cell>(order.back().component<Rare>()->value);
+  seen.clear();
+  order.clear();
+  for (auto e : container.entities<Rare, Cell>()) order.push_back(e);
+
+  container.entities<Rare, Cell>().each([&](Rare& r, Cell&) {
+    if (seen.empty()) order.back().destroy();
+    seen.push_back(r.value);
+  });
+
+  std::sort(seen.begin(), seen.end());
+  CHECK(seen.size() == 5);
+  CHECK(std::unique(seen.begin(), seen.end()) == seen.end());
+  CHECK(group.size() == 5);
+
+  // Removing the current Entity while iterating.
+  size_t visited = 0;
+  container.entities<Rare, Cell>().each([&](const Entity& e, Rare&, Cell&) {
+    ++visited;
+    e.destroy_component<Cell>();
+  });
+
+  CHECK(visited == 5);
+  CHECK(group.size() == 0);
+  CHECK(count(container.entities<Rare, Cell>()) == 0);
+}
+
+namespace {
+
+// Visit Position components of every third Entity with par_each, incrementing
+// their x, and check each was visited exactly once.
+template<typename... Ts>
+void check_par_each(Container& container, size_t chunk_size) {
+  ThreadPool pool(4);
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 5000; ++i) {
+    auto e = container.create();
+    if (i % 3 == 0) e.create_component<Position>(0, i);
+    if (i % 2 == 0) e.create_component<Rare>(i);
+    es.push_back(e);
+  }
+
+  container.entities<Position, Ts...>().par_each(pool,
+    [](Position& p, Ts&...) { ++p.x; }, chunk_size);
+
+  container.entities<Position, Ts...>().par_each(pool,
+    [](const Entity& e, Position& p, Ts&...) {
+      if (e.component<Position>().get() == &p) ++p.x;
+    }, chunk_size);
+
+  for (auto e : es) {
+    if (auto p = e.component<Position>()) {
+      auto expected = sizeof...(Ts) == 0 || e.component<Rare>() ? 2 : 0;
+      CHECK(p->x == expected);
+    }
+  }
+}
+
+} // anonymous namespace
+
+TEST_CASE("Parallel each") {
+  SECTION("all entities") {
+    Container container;
+    check_par_each<>(container, 0);
+  }
+
+  SECTION("all entities in chunks of one") {
+    Container container;
+    check_par_each<>(container, 1);
+  }
+
+  SECTION("sparse subset") {
+    Container container;
+    check_par_each<Rare>(container, 100);
+  }
+
+  SECTION("archetypes") {
+    Container container(Engine::archetypes);
+    check_par_each<Rare>(container, 0);
+  }
+
+  SECTION("group") {
+    Container container;
+    container.group<Rare, Cell>();
+
+    for (int i = 0; i < 1000; ++i) {
+      auto e = container.create();
+      e.create_component<Rare>(i);
+      if (i % 2) e.create_component<Cell>(i);
+    }
+
+    ThreadPool pool(4);
+    std::atomic<int> sum(0);
+
+    container.entities<Rare, Cell>().par_each(pool, [&](Rare& r, Cell& c) {
+      sum += r.value - c.value + 1;
+    }, 7);
+
+    CHECK(sum == 500);
+  }
+}
+
+TEST_CASE("Chunked each") {
+  Container container;
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 3000; ++i) {
+    auto e = container.create();
+    if (i % 7 != 3) e.create_component<Position>(i, 0);
+    if (i % 2 == 0) e.create_component<Rare>(i);
+    es.push_back(e);
+  }
+
+  SECTION("paged components come in runs of adjacent memory") {
+    size_t visited = 0;
+    size_t chunks  = 0;
+    bool   matches = true;
+
+    container.entities<Position>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Position> positions) {
+        ++chunks;
+        visited += indices.size();
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+          auto e = es[indices[i]];
+          matches = matches && &*e.component<Position>() == &positions[i]
+                            && positions[i].x == int(indices[i]);
+        }
+      });
+
+    CHECK(matches);
+    CHECK(visited == 3000 - 429);
+    CHECK(chunks < visited / 4);
+  }
+
+  SECTION("sparse components come one by one") {
+    size_t visited = 0;
+
+    container.entities<Position, Rare>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Position> p, Span<Rare> r) {
+        CHECK(indices.size() == 1);
+        CHECK(p[0].x == r[0].value);
+        ++visited;
+      });
+
+    CHECK(visited == count(container.entities<Position, Rare>()));
+  }
+
+  SECTION("excluded components get no span") {
+    size_t visited = 0;
+    bool   matches = true;
+
+    container.entities<Position, Without<Rare>>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Position> positions) {
+        visited += indices.size();
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+          matches = matches && indices[i] % 2 == 1
+                            && positions[i].x == int(indices[i]);
+        }
+      });
+
+    CHECK(matches);
+    CHECK(visited == count(container.entities<Position, Without<Rare>>()));
+
+    visited = 0;
+
+    container.entities<Rare, Without<Position>>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Rare> r) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+          matches = matches && r[i].value % 7 == 3
+                            && r[i].value == int(indices[i]);
+        }
+
+        visited += indices.size();
+      });
+
+    CHECK(matches);
+    CHECK(visited == count(container.entities<Rare, Without<Position>>()));
+  }
+
+  SECTION("a single sparse component is one run") {
+    size_t chunks = 0;
+
+    container.entities<Rare>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Rare> r) {
+        ++chunks;
+        CHECK(indices.size() == 1500);
+        CHECK(r.size() == 1500);
+        CHECK(r[10].value == int(indices[10]));
+      });
+
+    CHECK(chunks == 1);
+  }
+
+  SECTION("tags get no span") {
+    for (int i = 0; i < 1000; ++i) {
+      es[i].create_component<Velocity>();
+    }
+
+    size_t visited = 0;
+    size_t chunks  = 0;
+    bool   matches = true;
+
+    container.entities<Position, Velocity>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Position> positions) {
+        ++chunks;
+        visited += indices.size();
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+          matches = matches && indices[i] < 1000
+                            && positions[i].x == int(indices[i]);
+        }
+      });
+
+    CHECK(matches);
+    CHECK(visited == count(container.entities<Position, Velocity>()));
+    CHECK(chunks < visited / 4);
+
+    visited = 0;
+    chunks  = 0;
+
+    // Rare components of the first 1000 Entities are adjacent in its dense
+    // array.
+    container.entities<Rare, Velocity>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Rare> r) {
+        ++chunks;
+        visited += indices.size();
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+          matches = matches && indices[i] < 1000
+                            && r[i].value == int(indices[i]);
+        }
+      });
+
+    CHECK(matches);
+    CHECK(visited == 500);
+    CHECK(chunks == 1);
+  }
+
+  SECTION("a group is one run") {
+    container.group<Rare, Cell>();
+
+    for (int i = 0; i < 100; ++i) {
+      es[i].create_component<Cell>(i);
+    }
+
+    size_t chunks = 0;
+
+    container.entities<Rare, Cell>().each_chunk(
+      [&](Span<const uint32_t> indices, Span<Rare> r, Span<Cell> c) {
+        ++chunks;
+        CHECK(indices.size() == 50);
+        CHECK(r.size() == 50);
+
+        for (size_t i = 0; i < c.size(); ++i) {
+          CHECK(r[i].value == c[i].value);
+        }
+      });
+
+    CHECK(chunks == 1);
+  }
+}
+
+namespace {
+
+template<typename... Ts>
+std::vector<int> without(Container& container) {
+  std::vector<int> result;
+
+  container.entities<Position, Ts...>().each([&](Position& p) {
+    result.push_back(p.x);
+  });
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Exclude Components") {
+  auto check = [](Container& container) {
+    for (int i = 0; i < 12; ++i) {
+      auto e = container.create();
+      e.create_component<Position>(i);
+      if (i % 2) e.create_component<Velocity>();
+      if (i % 3) e.create_component<Rare>(i);
+    }
+
+    CHECK(without<Without<Velocity>>(container)
+          == (std::vector<int>{ 0, 2, 4, 6, 8, 10 }));
+    CHECK(without<Without<Rare>>(container)
+          == (std::vector<int>{ 0, 3, 6, 9 }));
+    auto neither = without<Without<Velocity>, Without<Rare>>(container);
+    CHECK(neither == (std::vector<int>{ 0, 6 }));
+
+    // Excluded components are not passed to each().
+    size_t count = 0;
+    container.entities<Without<Velocity>, Rare>().each(
+      [&](const Entity& e, Rare& r) {
+        CHECK(!e.component<Velocity>());
+        CHECK(r.value % 2 == 0);
+        ++count;
+      });
+    CHECK(count == 4);
+
+    // Iterators skip them too.
+    for (auto e : container.entities<Rare, Without<Velocity>>()) {
+      CHECK(!e.component<Velocity>());
+    }
+  };
+
+  SECTION("stores engine") {
+    Container container;
+    check(container);
+  }
+
+  SECTION("archetypes engine") {
+    Container container(Engine::archetypes);
+    check(container);
+  }
+}
+
+namespace {
+template<typename... Ts>
+std::vector<int> cached(Query<Ts...>& query) {
+  std::vector<int> result;
+
+  query.each([&](const Entity& e, auto&...) {
+    result.push_back(e.component<Position>()->x);
+  });
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+} // anonymous namespace
+
+TEST_CASE("Cached queries") {
+  Container container;
+  std::vector<Entity> es;
+
+  for (int i = 0; i < 6; ++i) {
+    auto e = container.create();
+    e.create_component<Position>(i);
+    if (i % 2) e.create_component<Rare>(i);
+    es.push_back(e);
+  }
+
+  auto& rare   = container.query<Position, Rare>();
+  auto& common = container.query<Position, Without<Rare>>();
+  auto& again  = container.query<Position, Rare>();
+  CHECK(&rare == &again);
+  CHECK(cached(rare)   == (std::vector<int>{ 1, 3, 5 }));
+  CHECK(cached(common) == (std::vector<int>{ 0, 2, 4 }));
+
+  // Structural changes update the queries.
+  es[0].create_component<Rare>();
+  es[3].destroy_component<Rare>();
+  es[5].destroy();
+  CHECK(cached(rare)   == (std::vector<int>{ 0, 1 }));
+  CHECK(cached(common) == (std::vector<int>{ 2, 3, 4 }));
+
+  auto e = container.create();
+  e.create_component<Rare>();
+  CHECK(rare.size() == 2);
+  e.create_component<Position>(6);
+  CHECK(cached(rare) == (std::vector<int>{ 0, 1, 6 }));
+
+  // Removing the current Entity while iterating is safe.
+  size_t count = 0;
+  rare.each([&](const Entity& e, Position&, Rare&) {
+    e.destroy_component<Rare>();
+    ++count;
+  });
+  CHECK(count == 3);
+  CHECK(rare.empty());
+  CHECK(cached(common) == (std::vector<int>{ 0, 1, 2, 3, 4, 6 }));
+
+  // Compacting the Container moves the indices.
+  container.compact();
+  CHECK(cached(common) == (std::vector<int>{ 0, 1, 2, 3, 4, 6 }));
+
+  size_t visited = 0;
+  for (auto entity : common.entities()) {
+    CHECK(entity.component<Position>());
+    ++visited;
+  }
+  CHECK(visited == 6);
+
+  // Removing other Entities while iterating visits each Entity once.
+  std::vector<Entity> order;
+  common.each([&](const Entity& e, Position&) { order.push_back(e); });
+
+  std::vector<int> seen;
+  common.each([&](Position& p) {
+    if (seen.empty()) order.back().destroy_component<Position>();
+    seen.push_back(p.x);
+  });
+
+  std::sort(seen.begin(), seen.end());
+  CHECK(seen.size() == 5);
+  CHECK(std::unique(seen.begin(), seen.end())
+        == seen.end());
+
+  order.clear();
+  for (auto entity : common.entities()) order.push_back(entity);
+
+  seen.clear();
+  for (auto entity : common.entities()) {
+    if (seen.empty()) order.back().destroy();
+    seen.push_back(entity.component<Position>()->x);
+  }
+
+  std::sort(seen.begin(), seen.end());
+  CHECK(seen.size() == 4);
+  CHECK(std::unique(seen.begin(), seen.end())
+        == seen.end());
+}
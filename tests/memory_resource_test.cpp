@@ -0,0 +1,277 @@
+#include "catch.hpp"
+#include "secs.h"
+#include "secs/any.h"
+#include "secs/memory_resource.h"
+
+using namespace secs;
+
+namespace {
+
+// Resource which counts the allocations it forwards to the upstream resource.
+class CountingResource : public MemoryResource {
+public:
+  size_t allocations   = 0;
+  size_t deallocations = 0;
+  size_t bytes         = 0;
+
+private:
+  void* do_allocate(size_t size, size_t alignment) override {
+    ++allocations;
+    bytes += size;
+    return new_delete_resource()->allocate(size, alignment);
+  }
+
+  void do_deallocate(void* p, size_t size, size_t alignment) override {
+    ++deallocations;
+    bytes -= size;
+    new_delete_resource()->deallocate(p, size, alignment);
+  }
+};
+
+struct Position {
+  Position(float x, float y) : x(x), y(y) {}
+  float x, y;
+};
+
+struct Velocity {
+  Velocity(float x, float y) : x(x), y(y) {}
+  float x, y;
+};
+struct Marker {};
+
+bool aligned(void* p, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+} // anonymous namespace
+
+TEST_CASE("MonotonicResource") {
+  CountingResource upstream;
+
+  {
+    MonotonicResource resource(64, upstream);
+
+    auto a = resource.allocate(8, 8);
+    auto b = resource.allocate(1, 1);
+    auto c = resource.allocate(16, 16);
+    CHECK(a != b);
+    CHECK(aligned(c, 16));
+    CHECK(upstream.allocations == 1);
+
+    // Larger than the chunk.
+    auto d = resource.allocate(1000, 64);
+    CHECK(aligned(d, 64));
+    CHECK(upstream.allocations == 2);
+
+    resource.deallocate(a, 8, 8);
+    CHECK(upstream.deallocations == 0);
+
+    resource.release();
+    CHECK(upstream.deallocations == 2);
+
+    resource.allocate(8);
+  }
+
+  CHECK(upstream.bytes == 0);
+}
+
+TEST_CASE("PoolResource") {
+  CountingResource upstream;
+
+  {
+    PoolResource resource(upstream);
+
+    auto a = resource.allocate(24, 8);
+    resource.deallocate(a, 24, 8);
+
+    // Freed block of the same size class is reused.
+    auto b = resource.allocate(32, 8);
+    CHECK(a == b);
+
+    auto c = resource.allocate(64, 64);
+    CHECK(aligned(c, 64));
+
+    // Large blocks come from upstream.
+    auto before = upstream.allocations;
+    auto d = resource.allocate(10000);
+    CHECK(upstream.allocations == before + 1);
+    resource.deallocate(d, 10000);
+    CHECK(upstream.deallocations == 1);
+  }
+
+  CHECK(upstream.bytes == 0);
+}
+
+TEST_CASE("Any allocates from the given resource") {
+  CountingResource resource;
+
+  {
+    Any any;
+    any.emplace_in<std::string>(resource, "hello");
+    CHECK(resource.allocations == 1);
+    CHECK(any.get<std::string>() == "hello");
+
+    Any other(std::move(any));
+    CHECK(other.contains<std::string>());
+  }
+
+  CHECK(resource.deallocations == 1);
+}
+
+TEST_CASE("Container allocates from the given resource") {
+  CountingResource resource;
+
+  {
+    Container container(resource);
+    CHECK(&container.resource() == &resource);
+
+    auto handler = [](auto&) {};
+    container.connect<Position>(handler);
+
+    for (int i = 0; i < 2000; ++i) {
+      auto e = container.create();
+      e.create_component<Position>(float(i), 0.0f);
+      if (i % 2) e.create_component<Velocity>(1.0f, 1.0f);
+      if (i % 3) e.create_component<Marker>();
+    }
+
+    CHECK(resource.allocations > 0);
+
+    size_t count = 0;
+    for (auto e : container.entities<Position, Velocity, Marker>()) {
+      (void) e;
+      ++count;
+    }
+    CHECK(count == 667);
+
+    auto  allocations = resource.allocations;
+    auto& moving      = container.query<Position, Velocity>();
+    CHECK(moving.size() == 1000);
+    CHECK(resource.allocations > allocations);
+  }
+
+  CHECK(resource.bytes == 0);
+  CHECK(resource.allocations == resource.deallocations);
+}
+
+TEST_CASE("Container in a monotonic arena") {
+  CountingResource  counting;
+  MonotonicResource counted(4096, counting);
+
+  Container container(Engine::archetypes, counted);
+
+  for (int i = 0; i < 100; ++i) {
+    container.create().create_component<Position>(1.0f, 2.0f);
+  }
+
+  for (auto e : container.entities<Position>()) {
+    CHECK(e.component<Position>()->y == 2.0f);
+  }
+
+  // Only a few chunks are needed, as they grow geometrically.
+  CHECK(counting.allocations < 10);
+}
+
+TEST_CASE("Archetype index allocates from the Container's resource") {
+  CountingResource stores, archetypes;
+
+  Container a(Engine::stores,     stores);
+  Container b(Engine::archetypes, archetypes);
+
+  for (auto container : { &a, &b }) {
+    for (int i = 0; i < 10; ++i) {
+      auto e = container->create();
+      e.create_component<Position>(1.0f, 2.0f);
+      if (i % 2) e.create_component<Velocity>(1.0f, 2.0f);
+    }
+
+    size_t count = 0;
+    for (auto e : container->entities<Position, Velocity>()) {
+      (void) e;
+      ++count;
+    }
+    CHECK(count == 5);
+  }
+
+  // Archetypes, their tables and transitions, and the matched tables.
+  CHECK(archetypes.allocations > stores.allocations + 5);
+}
+
+TEST_CASE("Relocations are allocated from the Container's resource") {
+  CountingResource resource;
+  Container container(resource);
+
+  auto a = container.create();
+  container.create().create_component<Position>(1.0f, 2.0f);
+  a.destroy();
+
+  auto relocations = container.compact();
+  REQUIRE(relocations.size() == 1);
+  CHECK(relocations.get_allocator().resource() == &resource);
+}
+
+TEST_CASE("Delegates allocate large callables from the given resource") {
+  CountingResource resource;
+
+  {
+    int data[16] = {};
+    data[15] = 42;
+
+    Delegate<int()> small;
+    small.assign_in(resource, [] { return 1; });
+    CHECK(small() == 1);
+    CHECK(resource.allocations == 0);
+
+    Delegate<int()> big;
+    big.assign_in(resource, [data] { return data[15]; });
+    CHECK(resource.allocations == 1);
+
+    Delegate<int()> moved = std::move(big);
+    CHECK(moved() == 42);
+    CHECK(resource.allocations == 1);
+  }
+
+  CHECK(resource.bytes == 0);
+  CHECK(resource.deallocations == 1);
+
+  {
+    Signal<int> signal(resource);
+
+    int data[16] = {};
+    int sum = 0;
+    signal.connect([data, &sum](int value) { sum += value + data[0]; });
+
+    signal(3);
+    CHECK(sum == 3);
+
+    // The slots keep their memory, the handler is returned to the resource.
+    auto bytes = resource.bytes;
+    signal.disconnect_all();
+    CHECK(resource.bytes < bytes);
+  }
+
+  CHECK(resource.bytes == 0);
+}
+
+TEST_CASE("DynamicTuple allocates its elements in blocks") {
+  CountingResource resource;
+
+  {
+    DynamicTuple tuple(resource);
+
+    tuple.get<int>() = 1;
+    tuple.get<double>() = 2.0;
+    tuple.get<Signal<Position>>();
+    tuple.get<ComponentStore<Position>>();
+
+    // Block of elements, table of elements and the creation order.
+    CHECK(resource.allocations <= 5);
+
+    auto& value = tuple.get<double>();
+    tuple.get<ComponentStore<Velocity>>();
+    CHECK(&tuple.get<double>() == &value);
+    CHECK(value == 2.0);
+  }
+
+  CHECK(resource.bytes == 0);
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include "catch.hpp"
+#include "secs/query_kernel.h"
+
+using namespace secs;
+using namespace secs::detail;
+
+TEST_CASE("Query kernel intersect") {
+  Bitset a;
+  Bitset b;
+  Bitset c;
+
+  for (size_t i = 0; i < 1000; ++i) {
+    a.set(i);
+    if (i % 2 == 0) b.set(i);
+  }
+
+  for (size_t i = 0; i < 500; i += 3) {
+    c.set(i);
+  }
+
+  Operand required[] = { operand(a), operand(b) };
+  Operand excluded[] = { operand(c) };
+
+  const size_t count = 20;
+  Bitset::Word words[count];
+
+  intersect(required, 2, excluded, 1, 0, count, words);
+
+  for (size_t i = 0; i < count * Bitset::WORD_BITS; ++i) {
+    bool expected = i < 1000 && i % 2 == 0 && (i >= 500 || i % 3 != 0);
+    CHECK(((words[i / 64] >> (i % 64)) & 1) == expected);
+  }
+
+  CHECK(kernel_name() != nullptr);
+}
+
+TEST_CASE("Query kernel implementations agree") {
+  // Operands of different sizes, so that the vector loops stop early and
+  // leave tails to the scalar one.
+  const size_t sizes[] = { 13, 7, 11, 3 };
+  Bitset bitsets[4];
+
+  uint64_t state = 0x9e3779b97f4a7c15;
+  for (size_t b = 0; b < 4; ++b) {
+    for (size_t i = 0; i < sizes[b] * Bitset::WORD_BITS; ++i) {
+      state = state * 6364136223846793005 + 1442695040888963407;
+      if ((state >> 33) % 3 != 0) bitsets[b].set(i);
+    }
+  }
+
+  Operand operands[4];
+  for (size_t b = 0; b < 4; ++b) operands[b] = operand(bitsets[b]);
+
+  const size_t count = 16;
+
+  for (size_t required = 1; required <= 2; ++required) {
+    for (size_t excluded = 0; excluded <= 2; ++excluded) {
+      for (size_t first = 0; first < 4; ++first) {
+        for (size_t n = 0; n <= count - first; ++n) {
+          Bitset::Word expected[count];
+          intersect_scalar( operands, required
+                          , operands + 2, excluded
+                          , first, n, expected);
+
+          for (size_t k = 0; k < n; ++k) {
+            Bitset::Word w = ~Bitset::Word(0);
+            for (size_t i = 0; i < required; ++i) {
+              w &= bitsets[i].word(first + k);
+            }
+            for (size_t i = 0; i < excluded; ++i) {
+              w &= ~bitsets[2 + i].word(first + k);
+            }
+            CHECK(expected[k] == w);
+          }
+
+#ifdef SECS_X86
+          Bitset::Word words[count];
+          intersect_sse2( operands, required
+                        , operands + 2, excluded
+                        , first, n, words);
+          CHECK(std::equal(words, words + n, expected));
+
+          if (avx2_supported()) {
+            intersect_avx2( operands, required
+                          , operands + 2, excluded
+                          , first, n, words);
+            CHECK(std::equal(words, words + n, expected));
+          }
+#endif
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Query kernel collect runs") {
+  Bitset::Word words[] = { 0, 0, 0 };
+  words[0] = (Bitset::Word(0b1101)) | (Bitset::Word(1) << 63);
+  words[1] = 0b11;
+  words[2] = Bitset::Word(1) << 5;
+
+  IndexRun runs[3 * Bitset::WORD_BITS / 2];
+  auto count = collect_runs(words, 3, 100, runs);
+
+  REQUIRE(count == 4);
+  CHECK(runs[0].first == 100);
+  CHECK(runs[0].count == 1);
+  CHECK(runs[1].first == 102);
+  CHECK(runs[1].count == 2);
+  CHECK(runs[2].first == 163);
+  CHECK(runs[2].count == 3);
+  CHECK(runs[3].first == 233);
+  CHECK(runs[3].count == 1);
+}
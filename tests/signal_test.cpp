@@ -94,3 +94,34 @@ TEST_CASE("Signal invocation") {
 
   CHECK(count == 6);
 }
+
+TEST_CASE("Signal batches") {
+  Signal<TestEvent> signal;
+
+  std::vector<TestEvent> events(3);
+  events[1].a = 1;
+  events[2].a = 2;
+
+  int    sum     = 0;
+  size_t batches = 0;
+
+  signal.connect([&](const TestEvent& e) { sum += e.a; });
+  auto connection = signal.connect_batch([&](secs::Span<const TestEvent> es) {
+    ++batches;
+    for (auto& e : es) sum += 10 * e.a;
+  });
+
+  signal.emit_batch(events);
+  CHECK(sum     == 33);
+  CHECK(batches == 1);
+
+  // Single events come as batches of one.
+  signal(events[1]);
+  CHECK(sum     == 44);
+  CHECK(batches == 2);
+
+  connection.disconnect();
+  signal.emit_batch(events);
+  CHECK(sum     == 47);
+  CHECK(batches == 2);
+}
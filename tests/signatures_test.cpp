@@ -0,0 +1,45 @@
+#include <vector>
+#include "catch.hpp"
+#include "secs/signatures.h"
+
+using namespace secs;
+
+namespace {
+std::vector<size_t> types(const Signatures& signatures, size_t entity) {
+  std::vector<size_t> result;
+  signatures.each(entity, [&](size_t type) { result.push_back(type); });
+  return result;
+}
+} // anonymous namespace
+
+TEST_CASE("Signatures") {
+  Signatures signatures;
+
+  CHECK(types(signatures, 10).empty());
+
+  signatures.set(10, 3);
+  signatures.set(10, 1);
+  signatures.set(2, 3);
+  CHECK(signatures.test(10, 3));
+  CHECK_FALSE(signatures.test(2, 1));
+  CHECK(types(signatures, 10) == (std::vector<size_t>{ 1, 3 }));
+
+  // Growing past a word keeps the existing types.
+  signatures.set(5, 200);
+  CHECK(types(signatures, 10) == (std::vector<size_t>{ 1, 3 }));
+  CHECK(types(signatures, 5) == (std::vector<size_t>{ 200 }));
+
+  signatures.reset(10, 1);
+  CHECK(types(signatures, 10) == (std::vector<size_t>{ 3 }));
+
+  signatures.move(10, 0);
+  CHECK(types(signatures, 0) == (std::vector<size_t>{ 3 }));
+  CHECK(types(signatures, 10).empty());
+
+  signatures.clear(5);
+  CHECK(types(signatures, 5).empty());
+
+  signatures.truncate(3);
+  CHECK(types(signatures, 2) == (std::vector<size_t>{ 3 }));
+  CHECK_FALSE(signatures.test(5, 200));
+}
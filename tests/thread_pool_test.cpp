@@ -0,0 +1,42 @@
+#include <atomic>
+#include <vector>
+#include "catch.hpp"
+#include "secs/thread_pool.h"
+
+using namespace secs;
+
+TEST_CASE("ThreadPool runs every task once") {
+  ThreadPool pool(4);
+  CHECK(pool.size() == 4);
+
+  std::vector<std::atomic<int>> calls(1000);
+  for (auto& c : calls) c = 0;
+
+  pool.run(calls.size(), [&](size_t i) { ++calls[i]; });
+
+  for (auto& c : calls) CHECK(c == 1);
+
+  // Tasks can run nested batches.
+  std::atomic<int> nested(0);
+
+  pool.run(8, [&](size_t) {
+    pool.run(8, [&](size_t) { ++nested; });
+  });
+
+  CHECK(nested == 64);
+}
+
+TEST_CASE("ThreadPool of one thread runs on the caller") {
+  ThreadPool pool(1);
+  CHECK(pool.size() == 1);
+
+  auto caller = std::this_thread::get_id();
+  size_t count = 0;
+
+  pool.run(10, [&](size_t) {
+    CHECK(std::this_thread::get_id() == caller);
+    ++count;
+  });
+
+  CHECK(count == 10);
+}
@@ -15,3 +15,14 @@ TEST_CASE("TypeIndexer") {
   CHECK(ti.get<Position>() != ti.get<Velocity>());
 }
 
+
+TEST_CASE("type_id") {
+  CHECK(type_id<Position>() == type_id<Position>());
+  CHECK(type_id<Position>() != type_id<Velocity>());
+
+  // Indices are shared by all TypeIndexers.
+  TypeIndexer a;
+  TypeIndexer b;
+  CHECK(a.get<Velocity>() == b.get<Velocity>());
+  CHECK(a.get<Velocity>() == type_id<Velocity>());
+}